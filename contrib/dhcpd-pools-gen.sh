@@ -0,0 +1,137 @@
+#!/bin/sh
+#
+# Generate synthetic dhcpd.conf and dhcpd.leases files for benchmarking
+# dhcpd-pools.  The files are written to a directory given as argument.
+#
+# Ranges are grouped four at the time, and every other group is inside of
+# a shared-network.  Requested percent of ranges overlap with the previous
+# range.  Configuration is spread to a tree of include files, so that the
+# main file includes inc-N.conf files, and each of them includes
+# inc-N-sub.conf.  Every lease address is written as many times as the
+# repeat count tells, with different binding states and cltt, as dhcpd
+# does when it appends to the lease file.
+#
+# Example:
+#	dhcpd-pools-gen.sh -r 2000 -l 1000000 -R 2 -o 5 -i 8 /tmp/bench4
+#	dhcpd-pools -c /tmp/bench4/dhcpd.conf -l /tmp/bench4/dhcpd.leases
+
+set -e
+
+usage() {
+	echo "usage: $(basename $0) [-6] [-r RANGES] [-l LEASES] [-R REPEAT] [-o OVERLAP%] [-i INCLUDES] [-s SEED] DIR"
+	exit $1
+}
+
+IPV=4
+RANGES=1000
+LEASES=100000
+REPEAT=1
+OVERLAP=0
+INCLUDES=0
+SEED=1
+
+while getopts 6r:l:R:o:i:s:h OPT; do
+	case $OPT in
+	6) IPV=6 ;;
+	r) RANGES=$OPTARG ;;
+	l) LEASES=$OPTARG ;;
+	R) REPEAT=$OPTARG ;;
+	o) OVERLAP=$OPTARG ;;
+	i) INCLUDES=$OPTARG ;;
+	s) SEED=$OPTARG ;;
+	h) usage 0 ;;
+	*) usage 1 ;;
+	esac
+done
+shift $((OPTIND - 1))
+if [ $# -ne 1 ]; then
+	usage 1
+fi
+mkdir -p "$1"
+DIR=$(cd "$1" && pwd)
+rm -f "$DIR"/dhcpd.conf "$DIR"/dhcpd.leases "$DIR"/inc-*.conf
+
+awk -v ipv=$IPV -v ranges=$RANGES -v leases=$LEASES -v repeat=$REPEAT \
+    -v overlap=$OVERLAP -v includes=$INCLUDES -v seed=$SEED -v dir="$DIR" '
+function v4(n) {
+	return sprintf("%d.%d.%d.%d", int(n / 16777216) % 256, int(n / 65536) % 256,
+		       int(n / 256) % 256, n % 256)
+}
+function v6(k, host) {
+	return sprintf("2001:db8:%x:%x::%x", int(k / 65536), k % 65536, host)
+}
+function conf_file(g,	f) {
+	f = g % (includes + 1)
+	if (f == 0)
+		return main
+	if (int(g / (includes + 1)) % 2)
+		return dir "/inc-" f "-sub.conf"
+	return dir "/inc-" f ".conf"
+}
+function subnet(k, out,	first, last) {
+	if (ipv == 4) {
+		first = 167772160 + k * 256 + 10
+		last = 167772160 + k * 256 + 249
+		if (0 < k && k % 100 < overlap)
+			first -= 50
+		printf("subnet %s netmask 255.255.255.0 {\n", v4(167772160 + k * 256)) > out
+		printf("\trange %s %s;\n}\n", v4(first), v4(last)) > out
+	} else {
+		printf("subnet6 %s/64 {\n", v6(k, 0)) > out
+		if (0 < k && k % 100 < overlap)
+			printf("\trange6 %s %s;\n}\n", v6(k - 1, 32768), v6(k, 65535)) > out
+		else
+			printf("\trange6 %s %s;\n}\n", v6(k, 256), v6(k, 65535)) > out
+	}
+}
+function state(	r) {
+	r = rand()
+	if (r < 0.6)
+		return "active"
+	if (r < 0.85)
+		return "free"
+	if (r < 0.9)
+		return "backup"
+	return "expired"
+}
+function lease(n, pass,	k, off, t, out) {
+	out = dir "/dhcpd.leases"
+	k = n % ranges
+	off = int(n / ranges)
+	t = sprintf("4 2026/10/01 %02d:%02d:%02d", pass % 24, int(n / 60) % 60, n % 60)
+	if (ipv == 4) {
+		printf("lease %s {\n", v4(167772160 + k * 256 + 10 + off % 240)) > out
+		printf("  starts %s;\n  ends %s;\n  cltt %s;\n", t, t, t) > out
+		printf("  binding state %s;\n", state()) > out
+		printf("  hardware ethernet 02:%02x:%02x:%02x:%02x:%02x;\n}\n",
+		       int(n / 16777216) % 256, int(n / 65536) % 256,
+		       int(n / 256) % 256, n % 256, pass % 256) > out
+	} else {
+		printf("ia-na \"%08x\" {\n  cltt %s;\n", n, t) > out
+		printf("  iaaddr %s {\n", v6(k, 256 + off % 65280)) > out
+		printf("    binding state %s;\n    max-life 7200;\n    ends %s;\n  }\n}\n",
+		       state(), t) > out
+	}
+}
+BEGIN {
+	srand(seed)
+	main = dir "/dhcpd.conf"
+	for (f = 1; f <= includes; f++) {
+		printf("include \"%s/inc-%d.conf\";\n", dir, f) > main
+		printf("include \"%s/inc-%d-sub.conf\";\n", dir, f) > (dir "/inc-" f ".conf")
+		printf("") > (dir "/inc-" f "-sub.conf")
+	}
+	for (k = 0; k < ranges; k++) {
+		g = int(k / 4)
+		out = conf_file(g)
+		if (g % 2 == 0 && k % 4 == 0)
+			printf("shared-network net-%d {\n", g) > out
+		subnet(k, out)
+		if (g % 2 == 0 && (k % 4 == 3 || k == ranges - 1))
+			printf("}\n") > out
+	}
+	distinct = int(leases / repeat)
+	for (pass = 0; pass < repeat; pass++)
+		for (n = 0; n < distinct; n++)
+			lease(n, pass)
+}'
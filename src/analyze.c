@@ -39,12 +39,33 @@
 
 #include <config.h>
 
+#include <arpa/inet.h>
+#include <errno.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "error.h"
 
 #include "dhcpd-pools.h"
 
+/*! \brief Sort ranges by address, and record the running maximum of
+ * range ends that find_range() uses to stop searching. */
+void sort_ranges(struct conf_t *state)
+{
+	unsigned int i;
+
+	qsort(state->ranges, state->num_ranges, sizeof(struct range_t), &rangecomp);
+	for (i = 0; i < state->num_ranges; i++) {
+		if (i && ipcomp(&state->ranges[i].last_ip, &state->ranges[i - 1].max_last) < 0)
+			copy_ipaddr(&state->ranges[i].max_last, &state->ranges[i - 1].max_last);
+		else
+			copy_ipaddr(&state->ranges[i].max_last, &state->ranges[i].last_ip);
+	}
+}
+
 /*! \brief Prepare data for analysis. The function will sort leases and
  * ranges. */
 void prepare_data(struct conf_t *state)
@@ -52,24 +73,154 @@ void prepare_data(struct conf_t *state)
 	/* Sort leases */
 	HASH_SORT(state->leases, leasecomp);
 	/* Sort ranges */
-	qsort(state->ranges, state->num_ranges, sizeof(struct range_t), &rangecomp);
+	sort_ranges(state);
+}
+
+/*! \brief Find lease time histogram bucket.
+ * \param duration Lease time in seconds.
+ * \return Index to lease_hist arrays. */
+static int lease_hist_bucket(uint32_t duration)
+{
+	int i;
+
+	duration /= LEASE_HIST_BASE;
+	for (i = 0; duration && i < NUM_OF_LEASE_HIST - 1; i++)
+		duration >>= 1;
+	return i;
+}
+
+/*! \brief Add range lease time histogram to a shared network. */
+static void add_lease_hist(struct shared_network_t *shared_p, const struct range_t *range_p)
+{
+	int i;
+
+	for (i = 0; i < NUM_OF_LEASE_HIST; i++)
+		shared_p->lease_hist[i] += range_p->lease_hist[i];
+}
+
+/*! \brief Forget the overlap sweep of a list of shared networks, pools,
+ * or classes. */
+static void sweep_reset(struct shared_network_t *shared_p)
+{
+	for (; shared_p; shared_p = shared_p->next)
+		shared_p->sweep_valid = 0;
+}
+
+/*! \brief Add range counters to a shared network, pool, or class.  Ranges
+ * are added in sorted order, and the sweep end of the aggregate is the
+ * highest address counted so far.  The part of a range at or below it
+ * was counted with an earlier range, so only addresses above it are
+ * added.  In the common case without overlap this is the whole range.
+ * \param l First lease of the range in the lease list, or NULL when the
+ * leases of overlapping ranges are not in more than one range counter.
+ * \return Number of range addresses that overlap earlier ranges. */
+static double add_range_counters(struct conf_t *state, struct shared_network_t *shared_p,
+				 const struct range_t *range_p, const struct leases_t *l)
+{
+	struct range_t seen;
+	double size = get_range_size(range_p), overlap;
+
+	if (!shared_p->sweep_valid || ipcomp(&shared_p->sweep_end, &range_p->first_ip) < 0) {
+		shared_p->available += size;
+		shared_p->used += range_p->count;
+		shared_p->touched += range_p->touched;
+		shared_p->backups += range_p->backups;
+		if (state->lease_histogram)
+			add_lease_hist(shared_p, range_p);
+		copy_ipaddr(&shared_p->sweep_end, &range_p->last_ip);
+		shared_p->sweep_valid = 1;
+		return 0;
+	}
+	copy_ipaddr(&seen.first_ip, &range_p->first_ip);
+	seen.prefix_len = range_p->prefix_len;
+	if (ipcomp(&range_p->last_ip, &shared_p->sweep_end) <= 0) {
+		/* range is within earlier ranges */
+		return size;
+	}
+	copy_ipaddr(&seen.last_ip, &shared_p->sweep_end);
+	overlap = get_range_size(&seen);
+	shared_p->available += size - overlap;
+	if (l == NULL) {
+		shared_p->used += range_p->count;
+		shared_p->touched += range_p->touched;
+		shared_p->backups += range_p->backups;
+		if (state->lease_histogram)
+			add_lease_hist(shared_p, range_p);
+	}
+	for (; l != NULL && ipcomp(&l->ip, &range_p->last_ip) <= 0; l = l->hh.next) {
+		if (ipcomp(&l->ip, &seen.last_ip) <= 0)
+			continue;
+		switch (l->type) {
+		case FREE:
+			shared_p->touched++;
+			break;
+		case ACTIVE:
+			shared_p->used++;
+			break;
+		case BACKUP:
+			shared_p->backups++;
+			break;
+		}
+		if (state->lease_histogram && l->duration)
+			shared_p->lease_hist[lease_hist_bucket(l->duration)]++;
+	}
+	copy_ipaddr(&shared_p->sweep_end, &range_p->last_ip);
+	return overlap;
+}
+
+/*! \brief Report overlapping ranges with one line, once per process so
+ * that long running modes and repeated runs do not flood stderr.
+ * \param range_p The first range that overlaps an earlier range.
+ * \param earlier The range it overlaps. */
+static void warn_overlap(struct conf_t *state, const struct range_t *range_p,
+			 const struct range_t *earlier)
+{
+	char ip[3][INET6_ADDRSTRLEN];
+
+	if (state->overlap_warned)
+		return;
+	state->overlap_warned = 1;
+	strcpy(ip[0], ntop_ipaddr(&range_p->first_ip));
+	strcpy(ip[1], ntop_ipaddr(&range_p->last_ip));
+	strcpy(ip[2], ntop_ipaddr(&earlier->first_ip));
+	error(0, 0, "warning: %u ranges overlap earlier ranges, first range %s - %s overlaps range %s - %s",
+	      state->overlap_ranges, ip[0], ip[1], ip[2], ntop_ipaddr(&earlier->last_ip));
 }
 
 /*!\brief Perform counting.  Join leases with ranges, and update range and
- * shared network counters.  */
+ * shared network counters.  Ranges that overlap are counted in full, but
+ * shared networks, pools, and classes count each address once.  */
 void do_counting(struct conf_t *state)
 {
 	struct range_t *restrict range_p = state->ranges;
 	const struct leases_t *restrict l = state->leases;
+	const struct leases_t *range_l;
+	const struct range_t *widest = NULL, *overlap_first = NULL, *overlap_with = NULL;
 	unsigned long i;
-	double block_size;
+	double overlap;
+	int spilled = 0;
 
+	if (state->fragmentation && state->ip_version == IPv4)
+		bitmap_init(state);
+	/* leases that did not fit in memory are counted from spill runs */
+	if (state->spill) {
+		spill_count(state);
+		spilled = 1;
+	}
+	state->shared_net_root->sweep_valid = 0;
+	sweep_reset(state->shared_net_root->next);
+	sweep_reset(state->pools);
+	sweep_reset(state->classes);
+	state->overlap_ranges = 0;
+	state->overlap_addresses = 0;
 	/* Walk through ranges */
 	for (i = 0; i < state->num_ranges; i++, range_p++) {
 		while (l != NULL && ipcomp(&range_p->first_ip, &l->ip) < 0)
 			l = l->hh.prev;	/* rewind */
 		if (l == NULL)
 			l = state->leases;
+		/* spilled addresses are counted only in one range */
+		range_l = spilled ? NULL : l;
 		for (; l != NULL && ipcomp(&l->ip, &range_p->last_ip) <= 0; l = l->hh.next) {
 			if (unlikely(ipcomp(&l->ip, &range_p->first_ip) < 0))
 				continue;	/* cannot happen? */
@@ -85,20 +236,179 @@ void do_counting(struct conf_t *state)
 				range_p->backups++;
 				break;
 			}
+			if (range_p->bitmap)
+				bitmap_mark(range_p, &l->ip, l->type);
+			if (l->duration)
+				range_p->lease_hist[lease_hist_bucket(l->duration)]++;
+		}
+		if (range_p->bitmap)
+			bitmap_analyze(range_p);
+		/* All networks, where overlapping ranges are noticed. */
+		overlap = add_range_counters(state, state->shared_net_root, range_p, range_l);
+		if (overlap) {
+			state->overlap_ranges++;
+			state->overlap_addresses += overlap;
+			if (overlap_first == NULL) {
+				overlap_first = range_p;
+				overlap_with = widest;
+			}
 		}
-		/* Size of range size. */
-		block_size = get_range_size(range_p);
-		/* Count together ranges within shared network block. */
-		range_p->shared_net->available += block_size;
-		range_p->shared_net->used += range_p->count;
-		range_p->shared_net->touched += range_p->touched;
-		range_p->shared_net->backups += range_p->backups;
+		if (widest == NULL || ipcomp(&widest->last_ip, &range_p->last_ip) < 0)
+			widest = range_p;
 		/* When shared network is not 'all networks' add it as well. */
-		if (range_p->shared_net != state->shared_net_root) {
-			state->shared_net_root->available += block_size;
-			state->shared_net_root->used += range_p->count;
-			state->shared_net_root->touched += range_p->touched;
-			state->shared_net_root->backups += range_p->backups;
+		if (range_p->shared_net != state->shared_net_root)
+			add_range_counters(state, range_p->shared_net, range_p, range_l);
+		/* Pools and the classes they allow or deny. */
+		if (range_p->pool) {
+			unsigned int j;
+
+			add_range_counters(state, range_p->pool, range_p, range_l);
+			for (j = 0; j < range_p->pool->num_classes; j++)
+				add_range_counters(state, range_p->pool->classes[j], range_p,
+						   range_l);
 		}
 	}
+	if (overlap_first)
+		warn_overlap(state, overlap_first, overlap_with);
+}
+
+/*! \brief Find the range an address belongs to.  Ranges must be sorted
+ * by sort_ranges().  When ranges overlap the first range that has the
+ * address is returned, which is the range do_counting() expects to have
+ * addresses that are counted only once.
+ * \return Pointer to a range, or NULL when address is not in any range. */
+struct range_t *find_range(struct conf_t *state, const union ipaddr_t *ip)
+{
+	long lo = 0, hi = (long)state->num_ranges - 1, mid;
+
+	/* the last range that does not start after the address */
+	while (lo <= hi) {
+		mid = (lo + hi) / 2;
+		if (ipcomp(&state->ranges[mid].first_ip, ip) <= 0)
+			lo = mid + 1;
+		else
+			hi = mid - 1;
+	}
+	if (hi < 0 || ipcomp(&state->ranges[hi].max_last, ip) < 0)
+		return NULL;
+	/* the first range that reaches the address */
+	lo = 0;
+	while (lo < hi) {
+		mid = (lo + hi) / 2;
+		if (ipcomp(&state->ranges[mid].max_last, ip) < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return state->ranges + lo;
+}
+
+/*! \brief Compare hardware addresses, used to sort the index. */
+static int maccomp(const struct macs_t *a, const struct macs_t *b)
+{
+	return memcmp(a->mac, b->mac, MAC_LEN);
+}
+
+/*! \brief Find clients that have more than one active lease.  Leases of
+ * such clients are sorted by address, and the client is counted in
+ * state->dup_across_ranges when the leases are in several ranges, and
+ * in state->dup_in_range when a range has more than one of them.  Ranges
+ * must be sorted by prepare_data() before calling this function. */
+void count_duplicates(struct conf_t *state)
+{
+	struct macs_t *m;
+
+	HASH_SORT(state->macs, maccomp);
+	for (m = state->macs; m; m = m->hh.next) {
+		struct leases_t *l, *sorted = NULL, **p;
+		struct range_t *r, *prev = NULL;
+		int in_range = 0;
+
+		if (m->count < 2)
+			continue;
+		/* clients do not have many leases, insertion sort is fine */
+		while (m->leases) {
+			l = m->leases;
+			m->leases = l->mac_next;
+			for (p = &sorted; *p && ipcomp(&(*p)->ip, &l->ip) < 0; p = &(*p)->mac_next)
+				/* find the place */ ;
+			l->mac_next = *p;
+			*p = l;
+		}
+		m->leases = sorted;
+		m->ranges = 0;
+		for (l = m->leases; l; l = l->mac_next) {
+			r = find_range(state, &l->ip);
+			if (r == NULL)
+				continue;
+			if (r == prev)
+				in_range = 1;
+			else
+				m->ranges++;
+			prev = r;
+		}
+		if (1 < m->ranges)
+			state->dup_across_ranges++;
+		if (in_range)
+			state->dup_in_range++;
+	}
+}
+
+/*! \brief Add state of a file to a stamp. */
+void file_stamp_add(struct file_stamp *stamp, const struct stat *st)
+{
+	if (stamp->mtime < st->st_mtime)
+		stamp->mtime = st->st_mtime;
+	stamp->size += st->st_size;
+}
+
+/*! \brief Analyze dhcpd files again, if they changed after the previous
+ * analysis.  This is used by long running modes.  A change is noticed
+ * when the newest modification time, or the sum of file sizes changes.
+ * The sizes catch lease file appends that happen within the same second.
+ * Files included by dhcpd.conf are checked as well, and their state is
+ * recorded when the parser opens them.
+ * New counters are published to the --shm segment in config order.
+ * \param stamp State of the files at previous analysis.
+ * \param print_mac_addreses Same as parse_leases() argument.
+ * \return One when analysis was done, zero when files did not change. */
+int refresh_analysis(struct conf_t *state, struct file_stamp *stamp,
+		     const int print_mac_addreses)
+{
+	struct stat st;
+	struct file_stamp now = { 0 }, all;
+	unsigned int i;
+	const char *path;
+
+	for (i = 0; i <= state->num_lease_files; i++) {
+		path = i ? state->lease_files[i - 1] : state->dhcpdconf_file;
+		if (stat(path, &st))
+			error(EXIT_FAILURE, errno, "refresh_analysis: %s", path);
+		file_stamp_add(&now, &st);
+	}
+	all = now;
+	for (i = 0; i < state->num_include_files; i++) {
+		if (stat(state->include_files[i], &st))
+			error(EXIT_FAILURE, errno, "refresh_analysis: %s", state->include_files[i]);
+		file_stamp_add(&all, &st);
+	}
+	if (stamp->valid && all.mtime == stamp->mtime && all.size == stamp->size)
+		return 0;
+	reset_analysis(state);
+	parse_config(state, 1, state->dhcpdconf_file, state->shared_net_root);
+	*stamp = now;
+	if (stamp->mtime < state->include_stamp.mtime)
+		stamp->mtime = state->include_stamp.mtime;
+	stamp->size += state->include_stamp.size;
+	stamp->valid = 1;
+	parse_lease_files(state, print_mac_addreses);
+	prepare_data(state);
+	do_counting(state);
+	if (state->shm_name)
+		shm_publish(state);
+	if (state->sorts != NULL)
+		mergesort_ranges(state, state->ranges, state->num_ranges, NULL, 1);
+	if (state->reverse_order == 1)
+		flip_ranges(state);
+	return 1;
 }
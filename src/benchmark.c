@@ -0,0 +1,212 @@
+/*
+ * The dhcpd-pools has BSD 2-clause license which also known as "Simplified
+ * BSD License" or "FreeBSD License".
+ *
+ * Copyright 2006- Sami Kerola. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the
+ *       distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR AND CONTRIBUTORS OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing
+ * official policies, either expressed or implied, of Sami Kerola.
+ */
+
+
+/*! \file benchmark.c
+ * \brief Phase timings, the --stats report, and the --benchmark results file.
+ *
+ * The main() marks end of every processing phase, and the wall clock and
+ * process cpu time since the previous mark is accumulated to the phase.
+ * The --stats report adds input volume, lease hash shape, and peak memory
+ * use to the timings.  When a results file is
+ * requested every output writer is also ran once to /dev/null, and the
+ * timings are appended to the file as a single line json object, so that
+ * runs of different versions can be compared with line oriented tools.
+ */
+
+#include <config.h>
+
+#include <errno.h>
+#include <stdio.h>
+#include <sys/resource.h>
+#include <time.h>
+
+#include "close-stream.h"
+#include "error.h"
+
+#include "dhcpd-pools.h"
+
+/*! \var bench_phase_names
+ * \brief Phase names in results file, indexed by enum bench_phase. */
+static const char *bench_phase_names[NUM_OF_PHASES] = {
+	[PHASE_CONFIG] = "parse_config",
+	[PHASE_LEASES] = "parse_leases",
+	[PHASE_PREPARE] = "prepare_data",
+	[PHASE_COUNTING] = "do_counting",
+	[PHASE_EXTRAS] = "extras",
+	[PHASE_SORT] = "sort",
+	[PHASE_OUTPUT] = "output"
+};
+
+/*! \brief Seconds between two time stamps. */
+static double bench_diff(const struct timespec *a, const struct timespec *b)
+{
+	return (b->tv_sec - a->tv_sec) + (b->tv_nsec - a->tv_nsec) / 1e9;
+}
+
+/*! \brief Start timing of first phase. */
+void bench_start(struct conf_t *state)
+{
+	clock_gettime(CLOCK_MONOTONIC, &state->bench_clock);
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &state->bench_cpu);
+}
+
+/*! \brief Add time since previous mark to a phase.
+ * \param phase The phase that just ended. */
+void bench_mark(struct conf_t *state, enum bench_phase phase)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	state->phase_time[phase] += bench_diff(&state->bench_clock, &now);
+	state->bench_clock = now;
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &now);
+	state->phase_cpu[phase] += bench_diff(&state->bench_cpu, &now);
+	state->bench_cpu = now;
+}
+
+/*! \brief Print one --stats value.
+ * \param json Print as member of json object, otherwise as text line. */
+static void stats_item(FILE *f, const int json, const char *name, double value)
+{
+	int decimals = value == (uint64_t)value ? 0 : 3;
+
+	if (json)
+		fprintf(f, ",\n            \"%s\":%.*f", name, decimals, value);
+	else
+		fprintf(f, "%-20s %12.*f\n", name, decimals, value);
+}
+
+/*! \brief Print statistics of the run.
+ * \param f Output stream.
+ * \param json When set print "stats" object to be embedded in json output
+ * trivia, otherwise print text.  The json is printed while output phase is
+ * running, so that phase is left out. */
+void stats_print(struct conf_t *state, FILE *f, const int json)
+{
+	const struct parse_stats_t *s = &state->stats;
+	UT_hash_table *tbl = state->leases ? state->leases->hh.tbl : NULL;
+	unsigned int i, used = 0, max_chain = 0;
+	int j, last = json ? PHASE_OUTPUT : NUM_OF_PHASES;
+	double rate = 0;
+	struct rusage ru;
+
+	if (json) {
+		fprintf(f, "         \"stats\": {\n");
+		fprintf(f, "            \"phases\": {");
+		for (j = 0; j < last; j++)
+			fprintf(f, "%s\"%s\":{\"wall\":%.6f,\"cpu\":%.6f}", j ? ", " : " ",
+				bench_phase_names[j], state->phase_time[j], state->phase_cpu[j]);
+		fprintf(f, " }");
+	} else {
+		fprintf(f, "%-20s %12s %12s\n", "phase", "wall", "cpu");
+		for (j = 0; j < last; j++)
+			fprintf(f, "%-20s %12.6f %12.6f\n", bench_phase_names[j],
+				state->phase_time[j], state->phase_cpu[j]);
+	}
+	stats_item(f, json, "conf_bytes", s->conf_bytes);
+	stats_item(f, json, "lease_bytes", s->lease_bytes);
+	stats_item(f, json, "lease_lines", s->lease_lines);
+	stats_item(f, json, "lease_records", s->lease_records);
+	stats_item(f, json, "repeated_records", s->repeated);
+	stats_item(f, json, "lease_bytes_skipped", s->lease_skipped);
+	stats_item(f, json, "lease_file_restarts", s->lease_restarts);
+	stats_item(f, json, "leases", HASH_COUNT(state->leases));
+	if (0 < state->phase_time[PHASE_LEASES])
+		rate = s->lease_records / state->phase_time[PHASE_LEASES];
+	stats_item(f, json, "leases_per_second", rate);
+	for (i = 0; tbl && i < tbl->num_buckets; i++) {
+		if (tbl->buckets[i].count == 0)
+			continue;
+		used++;
+		if (max_chain < tbl->buckets[i].count)
+			max_chain = tbl->buckets[i].count;
+	}
+	stats_item(f, json, "hash_buckets", tbl ? tbl->num_buckets : 0);
+	stats_item(f, json, "hash_used_buckets", used);
+	stats_item(f, json, "hash_max_chain", max_chain);
+	stats_item(f, json, "hash_mean_chain", used ? (double)tbl->num_items / used : 0);
+	stats_item(f, json, "hash_nonideal_items", tbl ? tbl->nonideal_items : 0);
+	if (getrusage(RUSAGE_SELF, &ru) == 0)
+		stats_item(f, json, "peak_rss_kb", ru.ru_maxrss);
+	if (json)
+		fprintf(f, "\n         }");
+}
+
+/*! \brief Time every output format writer, and append results to
+ * benchmark file. */
+void bench_write(struct conf_t *state)
+{
+	static const char formats[] = "taHcxXjJMP";
+	const char *output_file = state->output_file;
+	int output_format = state->output_format;
+	double writer_time[sizeof(formats)];
+	struct timespec start, end;
+	struct shared_network_t *shared_p;
+	unsigned int num_shnets = 0;
+	FILE *f;
+	size_t i;
+	int j;
+
+	state->output_file = "/dev/null";
+	for (i = 0; formats[i]; i++) {
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		output_analysis(state, formats[i]);
+		clock_gettime(CLOCK_MONOTONIC, &end);
+		writer_time[i] = bench_diff(&start, &end);
+	}
+	state->output_file = output_file;
+	state->output_format = output_format;
+	for (shared_p = state->shared_net_root->next; shared_p; shared_p = shared_p->next)
+		num_shnets++;
+
+	if ((f = fopen(state->benchmark_file, "a")) == NULL)
+		error(EXIT_FAILURE, errno, "bench_write: %s", state->benchmark_file);
+	fprintf(f, "{\"time\":%lld,\"version\":\"%s\",\"ip_version\":%d,",
+		(long long)time(NULL), PACKAGE_VERSION, state->ip_version == IPv6 ? 6 : 4);
+	fprintf(f, "\"lease_files\":%u,\"ranges\":%u,\"shared_networks\":%u,\"leases\":%u,",
+		state->num_lease_files, state->num_ranges, num_shnets,
+		HASH_COUNT(state->leases));
+	fprintf(f, "\"phases\":{");
+	for (j = 0; j < NUM_OF_PHASES; j++)
+		fprintf(f, "%s\"%s\":%.6f", j ? "," : "", bench_phase_names[j],
+			state->phase_time[j]);
+	fprintf(f, "},\"outputs\":{");
+	for (i = 0; formats[i]; i++)
+		fprintf(f, "%s\"%c\":%.6f", i ? "," : "", formats[i], writer_time[i]);
+	fprintf(f, "}}\n");
+	if (close_stream(f))
+		error(EXIT_FAILURE, errno, "bench_write: %s", state->benchmark_file);
+}
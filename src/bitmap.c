@@ -0,0 +1,216 @@
+/*
+ * The dhcpd-pools has BSD 2-clause license which also known as "Simplified
+ * BSD License" or "FreeBSD License".
+ *
+ * Copyright 2006- Sami Kerola. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the
+ *       distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR AND CONTRIBUTORS OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing
+ * official policies, either expressed or implied, of Sami Kerola.
+ */
+
+
+/*! \file bitmap.c
+ * \brief IPv4 range occupancy bitmaps and fragmentation statistics.
+ *
+ * Every address of a range has two bits: zero when the lease file does
+ * not have it, and lease type plus one otherwise.  The bitmap is filled
+ * while leases are counted, and the statistics are computed a word at a
+ * time.  A word of 32 addresses is folded to a mask of one bit per
+ * address in use, that is active or backup, and runs of free addresses
+ * are found with count trailing zeros instead of testing every address.
+ */
+
+#include <config.h>
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "xalloc.h"
+
+#include "dhcpd-pools.h"
+
+/*! \def BITMAP_MAX_ADDRESSES
+ * \brief Larger ranges do not get a bitmap.  A range of this size needs
+ * four megabytes.
+ */
+#define BITMAP_MAX_ADDRESSES (1 << 24)
+
+/*! \def ADDRS_PER_WORD
+ * \brief Number of addresses in a bitmap word.
+ */
+#define ADDRS_PER_WORD 32
+
+#ifdef HAVE_BUILTIN_BITOPS
+# define popcount32(x)	__builtin_popcount(x)
+# define ctz64(x)	__builtin_ctzll(x)
+# define clz32(x)	__builtin_clz(x)
+#else
+/*! \brief Count set bits. */
+static int popcount32(uint32_t x)
+{
+	x = x - ((x >> 1) & 0x55555555);
+	x = (x & 0x33333333) + ((x >> 2) & 0x33333333);
+	return (((x + (x >> 4)) & 0x0f0f0f0f) * 0x01010101) >> 24;
+}
+
+/*! \brief Count trailing zero bits, x must not be zero. */
+static int ctz64(uint64_t x)
+{
+	int n = 0;
+
+	while (!(x & 1)) {
+		x >>= 1;
+		n++;
+	}
+	return n;
+}
+
+/*! \brief Count leading zero bits, x must not be zero. */
+static int clz32(uint32_t x)
+{
+	int n = 0;
+
+	while (!(x & 0x80000000U)) {
+		x <<= 1;
+		n++;
+	}
+	return n;
+}
+#endif
+
+/*! \brief Fold 32 two bit states to a mask of addresses in use.  Active
+ * and backup states have the high bit set. */
+static uint32_t used_mask(uint64_t w)
+{
+	w = (w >> 1) & 0x5555555555555555ULL;
+	w = (w | (w >> 1)) & 0x3333333333333333ULL;
+	w = (w | (w >> 2)) & 0x0f0f0f0f0f0f0f0fULL;
+	w = (w | (w >> 4)) & 0x00ff00ff00ff00ffULL;
+	w = (w | (w >> 8)) & 0x0000ffff0000ffffULL;
+	w = (w | (w >> 16)) & 0x00000000ffffffffULL;
+	return w;
+}
+
+/*! \brief Allocate empty bitmaps to IPv4 ranges. */
+void bitmap_init(struct conf_t *state)
+{
+	struct range_t *range_p = state->ranges;
+	unsigned int i;
+	uint32_t n;
+
+	for (i = 0; i < state->num_ranges; i++, range_p++) {
+		n = range_p->last_ip.v4 - range_p->first_ip.v4 + 1;
+		if (n == 0 || BITMAP_MAX_ADDRESSES < n)
+			continue;
+		range_p->bitmap = xcalloc(1, sizeof(struct range_bitmap_t));
+		range_p->bitmap->words =
+		    xcalloc((n + ADDRS_PER_WORD - 1) / ADDRS_PER_WORD, sizeof(uint64_t));
+	}
+}
+
+/*! \brief Record lease state of an address to range bitmap. */
+void bitmap_mark(struct range_t *range_p, const union ipaddr_t *ip, enum ltype type)
+{
+	uint32_t idx = ip->v4 - range_p->first_ip.v4;
+	static const uint64_t bits[] = {
+		[FREE] = 1,
+		[ACTIVE] = 2,
+		[BACKUP] = 3
+	};
+	uint64_t *w = range_p->bitmap->words + idx / ADDRS_PER_WORD;
+	const int shift = 2 * (idx % ADDRS_PER_WORD);
+
+	*w = (*w & ~(3ULL << shift)) | bits[type] << shift;
+}
+
+/*! \brief Compute fragmentation statistics of a range bitmap. */
+void bitmap_analyze(struct range_t *range_p)
+{
+	struct range_bitmap_t *b = range_p->bitmap;
+	const uint32_t n = range_p->last_ip.v4 - range_p->first_ip.v4 + 1;
+	const uint32_t nwords = (n + ADDRS_PER_WORD - 1) / ADDRS_PER_WORD;
+	uint32_t i, used, free_m, valid, prev_used = 0, prev_free = 0, cur = 0;
+	uint64_t x;
+	int s, ones;
+
+	b->free_blocks = b->used_blocks = b->largest_free = 0;
+	b->has_used = 0;
+	for (i = 0; i < nwords; i++) {
+		valid = (i == nwords - 1 && n % ADDRS_PER_WORD)
+		    ? (1U << (n % ADDRS_PER_WORD)) - 1 : 0xffffffffU;
+		used = used_mask(b->words[i]) & valid;
+		free_m = ~used & valid;
+		/* a block starts where previous address is not of the same kind */
+		b->used_blocks += popcount32(used & ~((used << 1) | prev_used));
+		b->free_blocks += popcount32(free_m & ~((free_m << 1) | prev_free));
+		prev_used = used >> 31;
+		prev_free = free_m >> 31;
+		if (used) {
+			if (!b->has_used) {
+				b->first_used = range_p->first_ip.v4 + i * ADDRS_PER_WORD + ctz64(used);
+				b->has_used = 1;
+			}
+			b->last_used = range_p->first_ip.v4 + i * ADDRS_PER_WORD + 31 - clz32(used);
+		}
+		/* free runs of the word, continuing one from previous word */
+		if (!(free_m & 1))
+			cur = 0;
+		for (x = free_m; x;) {
+			s = ctz64(x);
+			if (s)
+				cur = 0;
+			ones = ctz64(~(x >> s));
+			cur += ones;
+			if (b->largest_free < cur) {
+				b->largest_free = cur;
+				b->largest_free_first =
+				    range_p->first_ip.v4 + i * ADDRS_PER_WORD + s + ones - cur;
+			}
+			if (s + ones < ADDRS_PER_WORD) {
+				cur = 0;
+				x &= ~0ULL << (s + ones);
+			} else
+				x = 0;
+		}
+	}
+}
+
+/*! \brief Free range bitmaps. */
+void bitmap_free(struct conf_t *state)
+{
+	unsigned int i;
+
+	for (i = 0; i < state->num_ranges; i++) {
+		if (state->ranges[i].bitmap == NULL)
+			continue;
+		free(state->ranges[i].bitmap->words);
+		free(state->ranges[i].bitmap);
+		state->ranges[i].bitmap = NULL;
+	}
+}
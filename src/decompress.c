@@ -0,0 +1,400 @@
+/*
+ * The dhcpd-pools has BSD 2-clause license which also known as "Simplified
+ * BSD License" or "FreeBSD License".
+ *
+ * Copyright 2006- Sami Kerola. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the
+ *       distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR AND CONTRIBUTORS OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing
+ * official policies, either expressed or implied, of Sami Kerola.
+ */
+
+
+/*! \file decompress.c
+ * \brief Lease file input, consistent reads and transparent decompression.
+ *
+ * A plain lease file is mapped to memory at its size when opened, and
+ * parsing stops at the end of the last complete record, so a record that
+ * dhcpd is still appending is not counted.  When dhcpd rewrites the file it
+ * renames a new file in place, and the mapping keeps the old contents
+ * intact until the read is done.  The file is checked for such a swap
+ * when it is closed.
+ *
+ * Compressed input is recognized by its magic bytes.  A thread of its own
+ * decompresses the file to a pipe, and the lease parser reads the other
+ * end of the pipe as if it was a plain file.  While the parser works on
+ * the stdio buffer of the read end the decompressor fills its output
+ * buffer and the pipe, so decompression overlaps with parsing, and the
+ * uncompressed bytes are never written to disk.
+ */
+
+#include <config.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef HAVE_PTHREAD
+# include <pthread.h>
+#endif
+#ifdef HAVE_ZLIB_H
+# include <zlib.h>
+#endif
+#ifdef HAVE_LZMA_H
+# include <lzma.h>
+#endif
+
+#include "error.h"
+#include "xalloc.h"
+
+#include "dhcpd-pools.h"
+
+/*! \def DECOMPRESS_BUFSIZ
+ * \brief Size of compressed input and uncompressed output buffers.
+ */
+#define DECOMPRESS_BUFSIZ 0x10000
+
+/*! \enum compression
+ * \brief Lease file compression formats.
+ */
+enum compression {
+	COMPRESSION_NONE,
+	COMPRESSION_GZIP,
+	COMPRESSION_XZ
+};
+
+/*! \struct decompress_t
+ * \brief Decompressor thread of a lease file.
+ */
+struct decompress_t {
+	enum compression type;
+	const char *path;		/*!< Lease file name, for error messages. */
+	int in_fd;			/*!< Compressed input. */
+	int out_fd;			/*!< Write end of the pipe to the parser. */
+	uint64_t bytes;			/*!< Uncompressed bytes written. */
+	dev_t dev;			/*!< Device and inode of the file when opened. */
+	ino_t ino;
+	char *map;			/*!< Memory mapping of a plain file, or NULL. */
+	size_t map_size;
+#ifdef HAVE_PTHREAD
+	pthread_t thread;
+#endif
+};
+
+/*! \brief Recognize compression by magic bytes in beginning of a file.
+ * Input that cannot be read from an offset, such as a pipe, is assumed to
+ * be uncompressed. */
+static enum compression detect_compression(int fd)
+{
+	unsigned char magic[6];
+
+	if (pread(fd, magic, sizeof(magic), 0) < 2)
+		return COMPRESSION_NONE;
+	if (magic[0] == 0x1f && magic[1] == 0x8b)
+		return COMPRESSION_GZIP;
+	if (!memcmp(magic, "\xfd" "7zXZ\0", sizeof(magic)))
+		return COMPRESSION_XZ;
+	return COMPRESSION_NONE;
+}
+
+/*! \brief Write a buffer to the parser. */
+static void decompress_write(struct decompress_t *d, const unsigned char *buf, size_t len)
+{
+	ssize_t n;
+
+	d->bytes += len;
+	while (len) {
+		n = write(d->out_fd, buf, len);
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			error(EXIT_FAILURE, errno, "decompress_write: %s", d->path);
+		}
+		buf += n;
+		len -= n;
+	}
+}
+
+/*! \brief Read compressed input.
+ * \return Number of bytes read, zero at end of file. */
+static size_t decompress_read(struct decompress_t *d, unsigned char *buf)
+{
+	ssize_t n;
+
+	do
+		n = read(d->in_fd, buf, DECOMPRESS_BUFSIZ);
+	while (n < 0 && errno == EINTR);
+	if (n < 0)
+		error(EXIT_FAILURE, errno, "decompress_read: %s", d->path);
+	return n;
+}
+
+#ifdef HAVE_ZLIB
+/*! \brief Decompress gzip file.  Files with many members, such as
+ * concatenated archives, are read to the end. */
+static void gunzip(struct decompress_t *d, unsigned char *in, unsigned char *out)
+{
+	z_stream z;
+	int ret = Z_OK;
+
+	memset(&z, 0, sizeof(z));
+	/* 32 turns on gzip header detection */
+	if (inflateInit2(&z, 15 + 32) != Z_OK)
+		error(EXIT_FAILURE, 0, "gunzip: %s: %s", d->path, z.msg ? z.msg : "init failed");
+	while (1) {
+		if (z.avail_in == 0) {
+			z.avail_in = decompress_read(d, in);
+			z.next_in = in;
+			if (z.avail_in == 0)
+				break;
+		}
+		if (ret == Z_STREAM_END && inflateReset(&z) != Z_OK)
+			error(EXIT_FAILURE, 0, "gunzip: %s: reset failed", d->path);
+		/* drain output before reading more input */
+		do {
+			z.next_out = out;
+			z.avail_out = DECOMPRESS_BUFSIZ;
+			ret = inflate(&z, Z_NO_FLUSH);
+			if (ret != Z_OK && ret != Z_STREAM_END && ret != Z_BUF_ERROR)
+				error(EXIT_FAILURE, 0, "gunzip: %s: %s", d->path,
+				      z.msg ? z.msg : "corrupt input");
+			decompress_write(d, out, DECOMPRESS_BUFSIZ - z.avail_out);
+		} while (z.avail_out == 0 && ret != Z_STREAM_END);
+	}
+	if (ret != Z_STREAM_END)
+		error(EXIT_FAILURE, 0, "gunzip: %s: unexpected end of file", d->path);
+	inflateEnd(&z);
+}
+#endif
+
+#ifdef HAVE_LZMA
+/*! \brief Decompress xz file. */
+static void unxz(struct decompress_t *d, unsigned char *in, unsigned char *out)
+{
+	lzma_stream s = LZMA_STREAM_INIT;
+	lzma_action action = LZMA_RUN;
+	lzma_ret ret;
+
+	if (lzma_stream_decoder(&s, UINT64_MAX, LZMA_CONCATENATED) != LZMA_OK)
+		error(EXIT_FAILURE, 0, "unxz: %s: init failed", d->path);
+	do {
+		if (s.avail_in == 0 && action == LZMA_RUN) {
+			s.avail_in = decompress_read(d, in);
+			s.next_in = in;
+			if (s.avail_in == 0)
+				action = LZMA_FINISH;
+		}
+		s.next_out = out;
+		s.avail_out = DECOMPRESS_BUFSIZ;
+		ret = lzma_code(&s, action);
+		if (ret != LZMA_OK && ret != LZMA_STREAM_END)
+			error(EXIT_FAILURE, 0, "unxz: %s: decoding failed: %d", d->path, ret);
+		decompress_write(d, out, DECOMPRESS_BUFSIZ - s.avail_out);
+	} while (ret != LZMA_STREAM_END);
+	lzma_end(&s);
+}
+#endif
+
+#ifdef HAVE_PTHREAD
+/*! \brief Decompressor thread.
+ * \param arg Pointer to decompress_t.
+ * \return Always NULL, failures are fatal. */
+static void *decompress_job(void *arg)
+{
+	struct decompress_t *d = arg;
+	unsigned char *in = xmalloc(DECOMPRESS_BUFSIZ);
+	unsigned char *out = xmalloc(DECOMPRESS_BUFSIZ);
+
+	switch (d->type) {
+	case COMPRESSION_GZIP:
+#ifdef HAVE_ZLIB
+		gunzip(d, in, out);
+#endif
+		break;
+	case COMPRESSION_XZ:
+#ifdef HAVE_LZMA
+		unxz(d, in, out);
+#endif
+		break;
+	default:
+		abort();
+	}
+	/* end of file to the parser */
+	close(d->out_fd);
+	close(d->in_fd);
+	free(in);
+	free(out);
+	return NULL;
+}
+#endif
+
+/*! \brief Find end of the last complete record, that is a closing brace
+ * at beginning of a line.
+ * \return Length of data that has complete records only. */
+static size_t complete_length(const char *map, size_t size)
+{
+	size_t i;
+
+	for (i = size; 0 < i; i--) {
+		if (map[i - 1] != '}' || (1 < i && map[i - 2] != '\n'))
+			continue;
+		if (i == size)
+			return i;
+		if (map[i] == '\n')
+			return i + 1;
+	}
+	return 0;
+}
+
+/*! \brief Open an uncompressed lease file.  Regular files are read from a
+ * memory mapping up to the last complete record, other files as they are.
+ * \return Stream of the file. */
+static FILE *snapshot_open(struct conf_t *state, struct decompress_t *d)
+{
+	struct stat st;
+	FILE *f;
+
+	if (fstat(d->in_fd, &st))
+		error(EXIT_FAILURE, errno, "lease_file_open: %s", d->path);
+	d->dev = st.st_dev;
+	d->ino = st.st_ino;
+#ifdef HAVE_FMEMOPEN
+	if (S_ISREG(st.st_mode) && 0 < st.st_size) {
+		size_t len;
+
+		d->map_size = st.st_size;
+		d->map = mmap(NULL, d->map_size, PROT_READ, MAP_PRIVATE, d->in_fd, 0);
+		if (d->map == MAP_FAILED)
+			error(EXIT_FAILURE, errno, "lease_file_open: mmap %s", d->path);
+		len = complete_length(d->map, d->map_size);
+		state->stats.lease_skipped += d->map_size - len;
+		if (len)
+			f = fmemopen(d->map, len, "r");
+		else
+			/* no complete records */
+			f = fopen("/dev/null", "r");
+		if (f == NULL)
+			error(EXIT_FAILURE, errno, "lease_file_open: %s", d->path);
+		return f;
+	}
+#endif
+	f = fdopen(d->in_fd, "r");
+	if (f == NULL)
+		error(EXIT_FAILURE, errno, "lease_file_open: %s", d->path);
+	return f;
+}
+
+/*! \brief Open a lease file for reading.  Compressed files are
+ * decompressed on the fly.
+ * \return Stream of uncompressed lease file. */
+FILE *lease_file_open(struct conf_t *state, const char *path)
+{
+	struct decompress_t *d;
+	int fd, pipefd[2];
+	FILE *f;
+
+	fd = open(path, O_RDONLY);
+	if (fd < 0)
+		error(EXIT_FAILURE, errno, "lease_file_open: %s", path);
+#ifdef HAVE_POSIX_FADVISE
+# ifdef POSIX_FADV_SEQUENTIAL
+	if (posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL) != 0)
+		error(EXIT_FAILURE, errno, "lease_file_open: fadvise %s", path);
+# endif				/* POSIX_FADV_SEQUENTIAL */
+#endif				/* HAVE_POSIX_FADVISE */
+	d = xcalloc(1, sizeof(struct decompress_t));
+	d->type = detect_compression(fd);
+	d->path = path;
+	d->in_fd = fd;
+	state->decompress = d;
+	if (d->type == COMPRESSION_NONE)
+		return snapshot_open(state, d);
+#ifndef HAVE_ZLIB
+	if (d->type == COMPRESSION_GZIP)
+		error(EXIT_FAILURE, 0, "lease_file_open: %s: gzip support is not compiled in", path);
+#endif
+#ifndef HAVE_LZMA
+	if (d->type == COMPRESSION_XZ)
+		error(EXIT_FAILURE, 0, "lease_file_open: %s: xz support is not compiled in", path);
+#endif
+#ifdef HAVE_PTHREAD
+	if (pipe(pipefd))
+		error(EXIT_FAILURE, errno, "lease_file_open: pipe");
+	d->out_fd = pipefd[1];
+	errno = pthread_create(&d->thread, NULL, decompress_job, d);
+	if (errno)
+		error(EXIT_FAILURE, errno, "lease_file_open: pthread_create");
+	f = fdopen(pipefd[0], "r");
+	if (f == NULL)
+		error(EXIT_FAILURE, errno, "lease_file_open: %s", path);
+	return f;
+#else
+	(void)pipefd;
+	error(EXIT_FAILURE, 0, "lease_file_open: %s: reading compressed files requires threads",
+	      path);
+	return NULL;
+#endif
+}
+
+/*! \brief Close a lease file opened with lease_file_open(), and account
+ * the uncompressed bytes read to statistics.
+ * \return Non-zero when the path refers to a different file than the one
+ * that was read, because dhcpd replaced it. */
+int lease_file_close(struct conf_t *state, FILE *f)
+{
+	struct decompress_t *d = state->decompress;
+	struct stat st;
+	int swapped = 0;
+
+	if (d->type == COMPRESSION_NONE) {
+		state->stats.lease_bytes += ftello(f);
+		if (!stat(d->path, &st) && (st.st_dev != d->dev || st.st_ino != d->ino))
+			swapped = 1;
+	}
+#ifdef HAVE_PTHREAD
+	else {
+		errno = pthread_join(d->thread, NULL);
+		if (errno)
+			error(EXIT_FAILURE, errno, "lease_file_close: pthread_join");
+		state->stats.lease_bytes += d->bytes;
+	}
+#endif
+	fclose(f);
+	if (d->map) {
+		munmap(d->map, d->map_size);
+		close(d->in_fd);
+	}
+	free(d);
+	state->decompress = NULL;
+	return swapped;
+}
@@ -0,0 +1,240 @@
+/*
+ * The dhcpd-pools has BSD 2-clause license which also known as "Simplified
+ * BSD License" or "FreeBSD License".
+ *
+ * Copyright 2006- Sami Kerola. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the
+ *       distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR AND CONTRIBUTORS OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing
+ * official policies, either expressed or implied, of Sami Kerola.
+ */
+
+
+/*! \file delta.c
+ * \brief Change detection between runs for --changed-only output.
+ *
+ * Counters of ranges and shared networks are saved to a state file, one
+ * record each.  A record is a fixed size key head, the shared network name
+ * of length given in the head, and the counters.  At next run the records
+ * are read to a hash, entries with equal counters are marked unchanged so
+ * that json, csv, and mustach writers skip them, and records that no
+ * longer match any entry are kept as tombstones of removed ranges and
+ * shared networks.
+ */
+
+#include <config.h>
+
+#include <errno.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "close-stream.h"
+#include "error.h"
+#include "xalloc.h"
+
+#include "dhcpd-pools.h"
+
+/*! \def DELTA_MAGIC
+ * \brief Delta state file identifier, including format version.
+ */
+#define DELTA_MAGIC "DPDELT02"
+
+/*! \def DELTA_NAME_MAX
+ * \brief Longest shared network name accepted from a state file.
+ */
+#define DELTA_NAME_MAX 65536
+
+/*! \struct delta_key
+ * \brief Head of delta hash key.  Ranges are keyed by their addresses,
+ * and shared networks by the name that follows the head.
+ */
+struct delta_key {
+	uint32_t is_range;
+	uint32_t name_len;		/*!< Length of the name after the head. */
+	union ipaddr_t first_ip;
+	union ipaddr_t last_ip;
+};
+
+/*! \struct delta_count
+ * \brief Persisted counters of a range or shared network.
+ */
+struct delta_count {
+	double count;			/*!< Used addresses. */
+	double touched;			/*!< Touched addresses. */
+	double backups;			/*!< Backup addresses. */
+};
+
+/*! \struct delta_t
+ * \brief Hash entry of a range or shared network.
+ */
+struct delta_t {
+	struct delta_key *key;		/*!< Key head followed by the name. */
+	size_t keylen;
+	struct delta_count c;
+	int seen;			/*!< Matched by an entry in this run. */
+	UT_hash_handle hh;
+};
+
+/*! \brief Read delta state file to a hash.
+ * \return Hash of previous run counters. */
+static struct delta_t *delta_read(struct conf_t *state)
+{
+	FILE *f;
+	char magic[8];
+	struct delta_t *head = NULL, *d;
+	struct delta_key k;
+
+	f = fopen(state->changed_file, "r");
+	if (f == NULL) {
+		if (errno == ENOENT)
+			return NULL;
+		error(EXIT_FAILURE, errno, "delta_read: %s", state->changed_file);
+	}
+	if (fread(magic, sizeof(magic), 1, f) != 1 || memcmp(magic, DELTA_MAGIC, sizeof(magic)))
+		error(EXIT_FAILURE, 0, "delta_read: %s: not a delta state file", state->changed_file);
+	while (fread(&k, sizeof(k), 1, f) == 1) {
+		if (DELTA_NAME_MAX < k.name_len)
+			error(EXIT_FAILURE, 0, "delta_read: %s: corrupted record",
+			      state->changed_file);
+		d = xmalloc(sizeof(struct delta_t));
+		d->keylen = sizeof(k) + k.name_len;
+		d->key = xmalloc(d->keylen);
+		memcpy(d->key, &k, sizeof(k));
+		if (fread(d->key + 1, 1, k.name_len, f) != k.name_len
+		    || fread(&d->c, sizeof(d->c), 1, f) != 1)
+			error(EXIT_FAILURE, ferror(f) ? errno : 0, "delta_read: %s: truncated record",
+			      state->changed_file);
+		d->seen = 0;
+		HASH_ADD_KEYPTR(hh, head, d->key, d->keylen, d);
+	}
+	if (ferror(f))
+		error(EXIT_FAILURE, errno, "delta_read: %s", state->changed_file);
+	fclose(f);
+	return head;
+}
+
+/*! \brief Compare counters to previous run, and save them.
+ * \param prev Hash of previous run counters.
+ * \param key Key head, followed by key->name_len bytes of name.
+ * \param c Counters of this run.
+ * \param out State file being written.
+ * \return Indicator if the counters are the same as in previous run. */
+static int delta_one(struct delta_t *prev, struct delta_key *key, struct delta_count *c,
+		     FILE *out)
+{
+	struct delta_t *d;
+	size_t keylen = sizeof(*key) + key->name_len;
+	int unchanged = 0;
+
+	HASH_FIND(hh, prev, key, keylen, d);
+	if (d) {
+		d->seen = 1;
+		unchanged = d->c.count == c->count && d->c.touched == c->touched
+		    && d->c.backups == c->backups;
+	}
+	if (fwrite(key, keylen, 1, out) != 1 || fwrite(c, sizeof(*c), 1, out) != 1)
+		error(EXIT_FAILURE, errno, "delta_one: write");
+	return unchanged;
+}
+
+/*! \brief Mark ranges and shared networks that did not change since the
+ * previous run, collect tombstones of removed ones, and save counters
+ * for the next run. */
+void delta_update(struct conf_t *state)
+{
+	struct delta_t *prev, *d;
+	struct delta_key *key;
+	struct delta_count c;
+	struct range_t *range_p;
+	struct shared_network_t *shared_p;
+	struct tombstone_t *t;
+	unsigned int i;
+	size_t len;
+	char *tmpname;
+	FILE *out;
+
+	prev = delta_read(state);
+	tmpname = xmalloc(strlen(state->changed_file) + sizeof(".tmp"));
+	sprintf(tmpname, "%s.tmp", state->changed_file);
+	out = fopen(tmpname, "w");
+	if (out == NULL)
+		error(EXIT_FAILURE, errno, "delta_update: %s", tmpname);
+	if (fwrite(DELTA_MAGIC, 8, 1, out) != 1)
+		error(EXIT_FAILURE, errno, "delta_update: %s", tmpname);
+	key = xcalloc(1, sizeof(struct delta_key));
+	for (i = 0, range_p = state->ranges; i < state->num_ranges; i++, range_p++) {
+		memset(key, 0, sizeof(struct delta_key));
+		key->is_range = 1;
+		copy_ipaddr(&key->first_ip, &range_p->first_ip);
+		copy_ipaddr(&key->last_ip, &range_p->last_ip);
+		c.count = range_p->count;
+		c.touched = range_p->touched;
+		c.backups = range_p->backups;
+		range_p->unchanged = delta_one(prev, key, &c, out);
+	}
+	for (shared_p = state->shared_net_root->next; shared_p; shared_p = shared_p->next) {
+		len = strlen(shared_p->name);
+		if (DELTA_NAME_MAX < len)
+			error(EXIT_FAILURE, 0, "delta_update: shared network name too long: %.32s...",
+			      shared_p->name);
+		key = xrealloc(key, sizeof(struct delta_key) + len);
+		memset(key, 0, sizeof(struct delta_key));
+		key->name_len = len;
+		memcpy(key + 1, shared_p->name, len);
+		c.count = shared_p->used;
+		c.touched = shared_p->touched;
+		c.backups = shared_p->backups;
+		shared_p->unchanged = delta_one(prev, key, &c, out);
+	}
+	free(key);
+	if (close_stream(out))
+		error(EXIT_FAILURE, errno, "delta_update: %s", tmpname);
+	if (rename(tmpname, state->changed_file))
+		error(EXIT_FAILURE, errno, "delta_update: rename %s", state->changed_file);
+	free(tmpname);
+	/* hash keeps file order, so tombstones are in previous run order */
+	while (prev) {
+		d = prev;
+		if (!d->seen) {
+			state->tombstones = xrealloc(state->tombstones, sizeof(struct tombstone_t) *
+						     (state->num_tombstones + 1));
+			t = &state->tombstones[state->num_tombstones++];
+			t->is_range = d->key->is_range;
+			t->first_ip = d->key->first_ip;
+			t->last_ip = d->key->last_ip;
+			t->name = xmalloc(d->key->name_len + 1);
+			memcpy(t->name, d->key + 1, d->key->name_len);
+			t->name[d->key->name_len] = '\0';
+		}
+		HASH_DEL(prev, d);
+		free(d->key);
+		free(d);
+	}
+}
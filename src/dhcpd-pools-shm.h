@@ -0,0 +1,160 @@
+/*
+ * The dhcpd-pools has BSD 2-clause license which also known as "Simplified
+ * BSD License" or "FreeBSD License".
+ *
+ * Copyright 2006- Sami Kerola. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the
+ *       distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR AND CONTRIBUTORS OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing
+ * official policies, either expressed or implied, of Sami Kerola.
+ */
+
+
+/*! \file dhcpd-pools-shm.h
+ * \brief Layout of the dhcpd-pools --shm segment, and the reader library.
+ *
+ * The segment starts with struct dhcpd_pools_shm_header, followed by the
+ * shared network and range records at offsets told in the header.  The
+ * first shared network record is 'All networks'.  The writer updates the
+ * segment under a sequence lock: seq is odd while an update is in
+ * progress, and a reader snapshot is consistent when seq was even and
+ * unchanged before and after copying the segment.  Readers never block
+ * the writer.
+ */
+
+#ifndef DHCPD_POOLS_SHM_H
+# define DHCPD_POOLS_SHM_H 1
+
+# include <stdint.h>
+
+# ifdef __cplusplus
+extern "C" {
+# endif
+
+/*! \def DHCPD_POOLS_SHM_MAGIC
+ * \brief First bytes of segment, "dpsh" in little endian. */
+# define DHCPD_POOLS_SHM_MAGIC 0x68737064
+/*! \def DHCPD_POOLS_SHM_VERSION
+ * \brief Layout version.  Changed when existing fields change; fields
+ * can be added to end of records without changing the version. */
+# define DHCPD_POOLS_SHM_VERSION 1
+/*! \def DHCPD_POOLS_SHM_NAME_LEN
+ * \brief Shared network name buffer size, longer names are truncated. */
+# define DHCPD_POOLS_SHM_NAME_LEN 64
+/*! \def DHCPD_POOLS_SHM_ADDR_LEN
+ * \brief Address string buffer size, large enough to IPv6 address. */
+# define DHCPD_POOLS_SHM_ADDR_LEN 48
+
+/*! \struct dhcpd_pools_shm_header
+ * \brief Beginning of the segment. */
+struct dhcpd_pools_shm_header {
+	uint32_t magic;			/*!< DHCPD_POOLS_SHM_MAGIC */
+	uint32_t version;		/*!< DHCPD_POOLS_SHM_VERSION */
+	uint64_t seq;			/*!< Sequence lock, odd during update. */
+	uint64_t segment_size;		/*!< Bytes in use, may grow between updates. */
+	int64_t updated;		/*!< Time of the update in unix epoch. */
+	uint32_t ip_version;		/*!< 4 or 6. */
+	uint32_t num_shnets;		/*!< Shared network records, including 'All networks'. */
+	uint32_t num_ranges;		/*!< Range records. */
+	uint32_t shnet_size;		/*!< Size of shared network record. */
+	uint32_t range_size;		/*!< Size of range record. */
+	uint32_t reserved;
+	uint64_t shnet_offset;		/*!< Offset of first shared network record. */
+	uint64_t range_offset;		/*!< Offset of first range record. */
+};
+
+/*! \struct dhcpd_pools_shm_shnet
+ * \brief Counters of a shared network. */
+struct dhcpd_pools_shm_shnet {
+	char name[DHCPD_POOLS_SHM_NAME_LEN];
+	double available;
+	double used;
+	double touched;
+	double backups;
+};
+
+/*! \struct dhcpd_pools_shm_range
+ * \brief Counters of a range. */
+struct dhcpd_pools_shm_range {
+	char first_ip[DHCPD_POOLS_SHM_ADDR_LEN];
+	char last_ip[DHCPD_POOLS_SHM_ADDR_LEN];
+	uint32_t shnet;			/*!< Index of shared network record, 0 when none. */
+	uint32_t reserved;
+	double available;
+	double used;
+	double touched;
+	double backups;
+};
+
+/*! \struct dhcpd_pools_shm_snapshot
+ * \brief Consistent copy of the segment made by dhcpd_pools_shm_read().
+ * The pointers refer to memory owned by the reader handle, and are valid
+ * until the next read or close. */
+struct dhcpd_pools_shm_snapshot {
+	uint64_t generation;		/*!< Number of updates, grows with every update. */
+	int64_t updated;
+	uint32_t ip_version;
+	uint32_t num_shnets;
+	uint32_t num_ranges;
+	uint32_t shnet_size;		/*!< Stride of shnets array. */
+	uint32_t range_size;		/*!< Stride of ranges array. */
+	const struct dhcpd_pools_shm_shnet *shnets;
+	const struct dhcpd_pools_shm_range *ranges;
+};
+
+/*! \def DHCPD_POOLS_SHM_SHNET
+ * \brief Shared network N of a snapshot, honoring record size of writer. */
+# define DHCPD_POOLS_SHM_SHNET(snap, n) ((const struct dhcpd_pools_shm_shnet *) \
+	((const char *)(snap)->shnets + (size_t)(n) * (snap)->shnet_size))
+/*! \def DHCPD_POOLS_SHM_RANGE
+ * \brief Range N of a snapshot, honoring record size of writer. */
+# define DHCPD_POOLS_SHM_RANGE(snap, n) ((const struct dhcpd_pools_shm_range *) \
+	((const char *)(snap)->ranges + (size_t)(n) * (snap)->range_size))
+
+/*! \brief Opaque reader handle. */
+struct dhcpd_pools_shm;
+
+/*! \brief Open a segment for reading.
+ * \param name Segment name given to dhcpd-pools --shm option.
+ * \return Reader handle, or NULL with errno set. */
+extern struct dhcpd_pools_shm *dhcpd_pools_shm_open(const char *name);
+
+/*! \brief Take a consistent snapshot of the segment.
+ * \return Zero on success, or -1 with errno set to EAGAIN when the
+ * segment was not yet written or stayed busy, EPROTO when the layout
+ * version is not supported, or other error of the system calls. */
+extern int dhcpd_pools_shm_read(struct dhcpd_pools_shm *shm,
+				struct dhcpd_pools_shm_snapshot *snap);
+
+/*! \brief Unmap the segment and free the reader handle. */
+extern void dhcpd_pools_shm_close(struct dhcpd_pools_shm *shm);
+
+# ifdef __cplusplus
+}
+# endif
+
+#endif /* DHCPD_POOLS_SHM_H */
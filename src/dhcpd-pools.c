@@ -45,6 +45,7 @@
 #include <getopt.h>
 #include <stdio.h>
 #include <limits.h>
+#include <stdint.h>
 
 #include "close-stream.h"
 #include "closeout.h"
@@ -55,16 +56,17 @@
 
 #include "dhcpd-pools.h"
 
-/* Function pointers */
-int (*parse_ipaddr) (struct conf_t *state, const char *restrict src, union ipaddr_t *restrict dst);
-void (*copy_ipaddr) (union ipaddr_t *restrict dst, const union ipaddr_t *restrict src);
-const char *(*ntop_ipaddr) (const union ipaddr_t *ip);
-double (*get_range_size) (const struct range_t *r);
-int (*xstrstr) (struct conf_t *state, const char *restrict str);
-int (*ipcomp) (const union ipaddr_t *restrict a, const union ipaddr_t *restrict b);
-int (*leasecomp) (const struct leases_t *restrict a, const struct leases_t *restrict b);
-void (*add_lease) (struct conf_t *state, union ipaddr_t *ip, enum ltype type);
-struct leases_t *(*find_lease) (struct conf_t *state, union ipaddr_t *ip);
+/* Function pointers.  These are thread local, so that threads analysing
+ * different dhcpd instances can use different IP versions. */
+THREAD_LOCAL int (*parse_ipaddr) (struct conf_t *state, const char *restrict src, union ipaddr_t *restrict dst);
+THREAD_LOCAL void (*copy_ipaddr) (union ipaddr_t *restrict dst, const union ipaddr_t *restrict src);
+THREAD_LOCAL const char *(*ntop_ipaddr) (const union ipaddr_t *ip);
+THREAD_LOCAL double (*get_range_size) (const struct range_t *r);
+THREAD_LOCAL int (*xstrstr) (struct conf_t *state, const char *restrict str);
+THREAD_LOCAL int (*ipcomp) (const union ipaddr_t *restrict a, const union ipaddr_t *restrict b);
+THREAD_LOCAL int (*leasecomp) (const struct leases_t *restrict a, const struct leases_t *restrict b);
+THREAD_LOCAL struct leases_t *(*add_lease) (struct conf_t *state, union ipaddr_t *ip, enum ltype type);
+THREAD_LOCAL struct leases_t *(*find_lease) (struct conf_t *state, union ipaddr_t *ip);
 
 /*! \brief An option argument parser to populate state header_limit and
  * number_limit values.
@@ -77,17 +79,6 @@ static int return_limit(const char c)
 	return 0;
 }
 
-/*! \brief Run time initialization. Global allocations, counter
- * initializations, etc are here. */
-static void prepare_memory(struct conf_t *state)
-{
-	state->ranges = xmalloc(sizeof(struct range_t) * state->ranges_size);
-	/* First shared network entry is all networks */
-	state->shared_net_root = xcalloc(sizeof(struct shared_network_t), 1);
-	state->shared_net_root->name = xstrdup("All networks");
-	state->shared_net_head = state->shared_net_root;
-}
-
 /*! \brief The --skip option argument parser. */
 static void skip_arg_parse(struct conf_t *state, char *optarg)
 {
@@ -145,7 +136,33 @@ static char parse_command_line_opts(struct conf_t *state, int argc, char **argv)
 		OPT_COLOR,
 		OPT_SKIP,
 		OPT_SET_IPV,
-		OPT_MUSTACH
+		OPT_MUSTACH,
+		OPT_LEASE_HIST,
+		OPT_HISTORY,
+		OPT_HISTORY_RETENTION,
+		OPT_HISTORY_QUERY,
+		OPT_FORECAST,
+		OPT_WARN_ETA,
+		OPT_CRIT_ETA,
+		OPT_MERGE,
+		OPT_DUPLICATES,
+		OPT_INDEX,
+		OPT_LOOKUP,
+		OPT_POOLS,
+		OPT_BENCHMARK,
+		OPT_STATS,
+		OPT_SNMP,
+		OPT_LISTEN,
+		OPT_SHM,
+		OPT_MANIFEST,
+		OPT_JOBS,
+		OPT_CHANGED,
+		OPT_EVENTS,
+		OPT_REPLAY,
+		OPT_ONLY_NET,
+		OPT_ONLY_SHARED,
+		OPT_MEMORY_LIMIT,
+		OPT_FRAGMENTATION
 	};
 
 	static struct option const long_options[] = {
@@ -170,6 +187,32 @@ static char parse_command_line_opts(struct conf_t *state, int argc, char **argv)
 		{"perfdata", no_argument, NULL, 'p'},
 		{"all-as-shared", no_argument, NULL, 'A'},
 		{"ip-version", required_argument, NULL, OPT_SET_IPV},
+		{"lease-histogram", no_argument, NULL, OPT_LEASE_HIST},
+		{"history", required_argument, NULL, OPT_HISTORY},
+		{"history-retention", required_argument, NULL, OPT_HISTORY_RETENTION},
+		{"history-query", required_argument, NULL, OPT_HISTORY_QUERY},
+		{"forecast", required_argument, NULL, OPT_FORECAST},
+		{"warn-eta", required_argument, NULL, OPT_WARN_ETA},
+		{"crit-eta", required_argument, NULL, OPT_CRIT_ETA},
+		{"merge", required_argument, NULL, OPT_MERGE},
+		{"duplicates", no_argument, NULL, OPT_DUPLICATES},
+		{"index", required_argument, NULL, OPT_INDEX},
+		{"lookup", no_argument, NULL, OPT_LOOKUP},
+		{"pools", no_argument, NULL, OPT_POOLS},
+		{"benchmark", required_argument, NULL, OPT_BENCHMARK},
+		{"stats", no_argument, NULL, OPT_STATS},
+		{"snmp-pass-persist", optional_argument, NULL, OPT_SNMP},
+		{"listen", required_argument, NULL, OPT_LISTEN},
+		{"shm", required_argument, NULL, OPT_SHM},
+		{"manifest", required_argument, NULL, OPT_MANIFEST},
+		{"jobs", required_argument, NULL, OPT_JOBS},
+		{"changed-only", required_argument, NULL, OPT_CHANGED},
+		{"events", required_argument, NULL, OPT_EVENTS},
+		{"replay", required_argument, NULL, OPT_REPLAY},
+		{"only-net", required_argument, NULL, OPT_ONLY_NET},
+		{"only-shared", required_argument, NULL, OPT_ONLY_SHARED},
+		{"memory-limit", required_argument, NULL, OPT_MEMORY_LIMIT},
+		{"fragmentation", no_argument, NULL, OPT_FRAGMENTATION},
 		{NULL, 0, NULL, 0}
 	};
 	char output_format = '\0';
@@ -187,8 +230,11 @@ static char parse_command_line_opts(struct conf_t *state, int argc, char **argv)
 			state->dhcpdconf_file = optarg;
 			break;
 		case 'l':
-			/* lease file */
-			state->dhcpdlease_file = optarg;
+			/* lease file, failover peers can have one each */
+			state->lease_files = xrealloc(state->lease_files,
+						      sizeof(char *) * (state->num_lease_files + 1));
+			state->lease_files[state->num_lease_files] = optarg;
+			state->num_lease_files++;
 			break;
 		case 'f':
 			/* Output format */
@@ -241,6 +287,14 @@ static char parse_command_line_opts(struct conf_t *state, int argc, char **argv)
 			if (state->color_mode == color_unknown)
 				error(EXIT_FAILURE, errno, "unknown color mode: %s", quote(optarg));
 			break;
+		case OPT_MERGE:
+			if (!strcmp(optarg, "cltt"))
+				state->merge_rule = MERGE_CLTT;
+			else if (!strcmp(optarg, "state"))
+				state->merge_rule = MERGE_STATE;
+			else
+				error(EXIT_FAILURE, 0, "unknown --merge rule: %s", quote(optarg));
+			break;
 		case OPT_SKIP:
 			skip_arg_parse(state, optarg);
 			break;
@@ -263,6 +317,17 @@ static char parse_command_line_opts(struct conf_t *state, int argc, char **argv)
 			alarming = 1;
 			state->crit_count = strtod_or_err(optarg, "illegal argument");
 			break;
+		case OPT_FORECAST:
+			state->forecast_file = optarg;
+			break;
+		case OPT_WARN_ETA:
+			alarming = 1;
+			state->warn_eta = 3600 * strtod_or_err(optarg, "illegal argument");
+			break;
+		case OPT_CRIT_ETA:
+			alarming = 1;
+			state->crit_eta = 3600 * strtod_or_err(optarg, "illegal argument");
+			break;
 		case OPT_MINSIZE:
 			state->minsize = strtod_or_err(optarg, "illegal argument");
 			break;
@@ -278,6 +343,122 @@ static char parse_command_line_opts(struct conf_t *state, int argc, char **argv)
 				error(EXIT_FAILURE, 0, "unknown --ip-version argument: %s", optarg);
 			}
 			break;
+		case OPT_LEASE_HIST:
+			state->lease_histogram = 1;
+			state->lease_times = 1;
+			break;
+		case OPT_DUPLICATES:
+			state->duplicates = 1;
+			break;
+		case OPT_INDEX:
+			state->index_file = optarg;
+			break;
+		case OPT_LOOKUP:
+			state->lookup = 1;
+			break;
+		case OPT_POOLS:
+			state->pool_counting = 1;
+			break;
+		case OPT_BENCHMARK:
+			state->benchmark_file = optarg;
+			break;
+		case OPT_STATS:
+			state->print_stats = 1;
+			break;
+		case OPT_SNMP:
+			state->snmp_root = optarg ? optarg : SNMP_ROOT_OID;
+			break;
+		case OPT_LISTEN:
+			state->listen = optarg;
+			break;
+		case OPT_SHM:
+			state->shm_name = optarg;
+			break;
+		case OPT_MANIFEST:
+			state->manifest_file = optarg;
+			break;
+		case OPT_CHANGED:
+			state->changed_file = optarg;
+			break;
+		case OPT_EVENTS:
+			state->events_file = optarg;
+			/* Event time stamps are client last transaction times. */
+			state->lease_times = 1;
+			break;
+		case OPT_REPLAY:
+			{
+				double num = strtod_or_err(optarg, "illegal argument");
+
+				if (num < 1 || INT32_MAX / 60 < num)
+					error(EXIT_FAILURE, 0, "--replay out of range: %s", optarg);
+				state->replay_interval = 60 * num;
+				/* Replay clock is client last transaction time. */
+				state->lease_times = 1;
+			}
+			break;
+		case OPT_ONLY_NET:
+			{
+				struct range_t net;
+				char *cidr;
+
+				if (!strchr(optarg, '/'))
+					error(EXIT_FAILURE, 0, "--only-net requires cidr: %s", optarg);
+				cidr = xstrdup(optarg);
+				parse_cidr(state, &net, cidr);
+				free(cidr);
+				copy_ipaddr(&state->only_first, &net.first_ip);
+				copy_ipaddr(&state->only_last, &net.last_ip);
+				state->only_net = 1;
+			}
+			break;
+		case OPT_ONLY_SHARED:
+			state->only_shared = optarg;
+			break;
+		case OPT_FRAGMENTATION:
+			state->fragmentation = 1;
+			break;
+		case OPT_MEMORY_LIMIT:
+			{
+				double num = strtod_or_err(optarg, "illegal argument");
+
+				if (num <= 0 || SIZE_MAX / (1 << 20) < num)
+					error(EXIT_FAILURE, 0, "--memory-limit out of range: %s", optarg);
+				state->memory_limit = num * (1 << 20);
+			}
+			break;
+		case OPT_JOBS:
+			{
+				double num = strtod_or_err(optarg, "illegal argument");
+
+				if (num < 1 || 1024 < num)
+					error(EXIT_FAILURE, 0, "--jobs out of range: %s", optarg);
+				state->num_jobs = num;
+			}
+			break;
+		case OPT_HISTORY:
+			state->history_file = optarg;
+			break;
+		case OPT_HISTORY_RETENTION:
+			{
+				double num = strtod_or_err(optarg, "illegal argument");
+
+				if (num < 1 || UINT32_MAX < num)
+					error(EXIT_FAILURE, 0, "--history-retention out of range: %s", optarg);
+				state->history_retention = num;
+			}
+			break;
+		case OPT_HISTORY_QUERY:
+			{
+				char *sep = strchr(optarg, ',');
+
+				if (sep) {
+					*sep = '\0';
+					state->history_select = sep + 1;
+				}
+				state->history_window = 3600 * strtod_or_err(optarg, "illegal argument");
+				state->history_query = 1;
+			}
+			break;
 		case 'p':
 			/* Print additional performance data in alarming mode */
 			state->perfdata = 1;
@@ -301,8 +482,26 @@ static char parse_command_line_opts(struct conf_t *state, int argc, char **argv)
 	if (state->dhcpdconf_file == NULL)
 		state->dhcpdconf_file = DHCPDCONF_FILE;
 	/* Use default dhcpd.leases when user did not define anything. */
-	if (state->dhcpdlease_file == NULL)
-		state->dhcpdlease_file = DHCPDLEASE_FILE;
+	if (state->num_lease_files == 0) {
+		state->lease_files = xmalloc(sizeof(char *));
+		state->lease_files[0] = DHCPDLEASE_FILE;
+		state->num_lease_files = 1;
+	}
+	state->dhcpdlease_file = state->lease_files[0];
+	/* Merging needs client last transaction times. */
+	if (1 < state->num_lease_files)
+		state->lease_times = 1;
+	if (state->history_query && state->history_file == NULL)
+		error(EXIT_FAILURE, 0, "--history-query requires --history option");
+	if (state->lookup && optind == argc)
+		error(EXIT_FAILURE, 0, "--lookup requires address arguments");
+	if ((state->warn_eta || state->crit_eta) && state->forecast_file == NULL)
+		error(EXIT_FAILURE, 0, "--warn-eta and --crit-eta require --forecast option");
+	if (state->manifest_file
+	    && (state->history_file || state->forecast_file || state->index_file || state->lookup
+		|| state->snmp_root || state->listen || state->shm_name || state->benchmark_file
+		|| state->changed_file || state->events_file || state->replay_interval))
+		error(EXIT_FAILURE, 0, "--manifest cannot be used with options that track a single instance");
 	/* Use default limits when user did not define anything. */
 	if (state->header_limit == 8) {
 		char const *default_limit = OUTPUT_LIMIT;
@@ -321,6 +520,12 @@ static char parse_command_line_opts(struct conf_t *state, int argc, char **argv)
 			output_format = default_format[0];
 		}
 	}
+	/* Spilled leases have only address and state. */
+	if (state->memory_limit
+	    && (output_format == 'X' || output_format == 'J' || state->duplicates
+		|| state->index_file || state->lookup || state->events_file
+		|| state->replay_interval || state->lease_histogram || 1 < state->num_lease_files))
+		error(EXIT_FAILURE, 0, "--memory-limit cannot be used with options that need individual leases");
 	return output_format;
 }
 
@@ -342,6 +547,7 @@ int main(int argc, char **argv)
 		.color_mode = color_auto,
 		.ranges_size = 64,
 		.ip_version = IPvUNKNOWN,
+		.history_retention = 1440,
 		0
 	};
 	char output_format;
@@ -353,19 +559,81 @@ int main(int argc, char **argv)
 	set_ipv_functions(&state, IPvUNKNOWN);
 	output_format = parse_command_line_opts(&state, argc, argv);
 
+	if (state.history_query) {
+		ret_val = history_query(&state, output_format);
+		clean_up(&state);
+		return (ret_val);
+	}
+	if (state.lookup) {
+		ret_val = lookup_query(&state, output_format, argv + optind, argc - optind);
+		clean_up(&state);
+		return (ret_val);
+	}
+	if (state.snmp_root) {
+		ret_val = snmp_pass_persist(&state);
+		clean_up(&state);
+		return (ret_val);
+	}
+	if (state.listen) {
+		ret_val = http_serve(&state);
+		clean_up(&state);
+		return (ret_val);
+	}
+	if (state.replay_interval) {
+		ret_val = replay_run(&state, output_format);
+		clean_up(&state);
+		return (ret_val);
+	}
+	if (state.events_file) {
+		ret_val = events_run(&state);
+		clean_up(&state);
+		return (ret_val);
+	}
+	if (state.manifest_file) {
+		ret_val = manifest_run(&state, output_format);
+		clean_up(&state);
+		return (ret_val);
+	}
 	/* Do the job */
+	bench_start(&state);
 	parse_config(&state, 1, state.dhcpdconf_file, state.shared_net_root);
-	if (output_format == 'X' || output_format == 'J')
-		parse_leases(&state, 1);
+	bench_mark(&state, PHASE_CONFIG);
+	if (output_format == 'X' || output_format == 'J' || state.duplicates || state.index_file
+	    || state.benchmark_file)
+		parse_lease_files(&state, 1);
 	else
-		parse_leases(&state, 0);
+		parse_lease_files(&state, 0);
+	bench_mark(&state, PHASE_LEASES);
 	prepare_data(&state);
+	bench_mark(&state, PHASE_PREPARE);
 	do_counting(&state);
+	bench_mark(&state, PHASE_COUNTING);
+	if (state.duplicates)
+		count_duplicates(&state);
+	if (state.index_file)
+		lookup_write(&state);
+	if (state.history_file)
+		history_append(&state);
+	if (state.forecast_file)
+		forecast_update(&state);
+	if (state.shm_name)
+		shm_publish(&state);
+	if (state.changed_file)
+		delta_update(&state);
+	bench_mark(&state, PHASE_EXTRAS);
 	if (state.sorts != NULL)
 		mergesort_ranges(&state, state.ranges, state.num_ranges, NULL, 1);
 	if (state.reverse_order == 1)
 		flip_ranges(&state);
+	bench_mark(&state, PHASE_SORT);
 	ret_val = output_analysis(&state, output_format);
+	bench_mark(&state, PHASE_OUTPUT);
+	/* json output has the stats in trivia */
+	if (state.print_stats
+	    && !((output_format == 'j' || output_format == 'J') && state.header_limit & A_BIT))
+		stats_print(&state, stderr, 0);
+	if (state.benchmark_file)
+		bench_write(&state);
 	clean_up(&state);
 	return (ret_val);
 }
@@ -45,6 +45,9 @@
 # include <stddef.h>
 # include <stdio.h>
 # include <string.h>
+# include <sys/stat.h>
+# include <sys/types.h>
+# include <time.h>
 # include <uthash.h>
 
 /*! \def likely(x)
@@ -72,6 +75,15 @@
 #  define _DP_ATTRIBUTE_HOT	/* empty */
 # endif
 
+/*! \def USE_THREADS
+ * \brief Lease files and manifest instances are analyzed in threads only
+ * when the ip version function pointers and the static buffers of address
+ * printing can be thread local.
+ */
+# if defined(HAVE_PTHREAD) && defined(HAVE_THREAD_LOCAL)
+#  define USE_THREADS 1
+# endif
+
 /*! \union ipaddr_t
  * \brief Memory space for a binary IP address saving. */
 union ipaddr_t {
@@ -95,6 +107,7 @@ enum dhcp_version {
  */
 enum prefix_t {
 	PREFIX_LEASE,
+	PREFIX_IAPREFIX,
 	PREFIX_BINDING_STATE_FREE,
 	PREFIX_BINDING_STATE_ABANDONED,
 	PREFIX_BINDING_STATE_EXPIRED,
@@ -102,9 +115,36 @@ enum prefix_t {
 	PREFIX_BINDING_STATE_ACTIVE,
 	PREFIX_BINDING_STATE_BACKUP,
 	PREFIX_HARDWARE_ETHERNET,
+	PREFIX_STARTS,
+	PREFIX_ENDS,
+	PREFIX_MAX_LIFE,
+	PREFIX_CLTT,
 	NUM_OF_PREFIX
 };
 
+/*! \enum merge_rule
+ * \brief Rule to select a lease when several lease files have the same
+ * address, such as dhcpd failover peers.
+ */
+enum merge_rule {
+	MERGE_CLTT,		/*!< Default, newest client last transaction time wins. */
+	MERGE_STATE		/*!< Active lease wins, otherwise newest cltt. */
+};
+
+/*! \enum bench_phase
+ * \brief Phases timed by --benchmark and --stats.
+ */
+enum bench_phase {
+	PHASE_CONFIG,
+	PHASE_LEASES,
+	PHASE_PREPARE,
+	PHASE_COUNTING,
+	PHASE_EXTRAS,		/*!< Duplicates, index, history, and forecast. */
+	PHASE_SORT,
+	PHASE_OUTPUT,
+	NUM_OF_PHASES
+};
+
 /*! \enum color_mode
  * \brief Enumeration whether to use or not color output.
  */
@@ -115,6 +155,14 @@ enum color_mode {
 	color_auto		/*!< Default, use colors when output terminal is interactive. */
 };
 
+/*! \def NUM_OF_LEASE_HIST
+ * \brief Number of lease time histogram buckets.  The first bucket holds
+ * leases shorter than LEASE_HIST_BASE seconds, and each following bucket
+ * doubles the limit.  The last bucket is open ended.
+ */
+# define NUM_OF_LEASE_HIST 20
+# define LEASE_HIST_BASE 64
+
 /*! \struct shared_network_t
  * \brief Counters for an individual shared network.  This data entry is
  * also used for 'all networks' counting.
@@ -126,19 +174,61 @@ struct shared_network_t {
 	double touched;
 	double backups;
 	int netmask;
+	double growth_rate;
+	double eta;
+	int unchanged;				/* counters same as in previous --changed-only run */
+	uint32_t lease_hist[NUM_OF_LEASE_HIST];
+	struct shared_network_t **classes;	/* classes a pool allows or denies, pools only */
+	unsigned int num_classes;
+	union ipaddr_t sweep_end;		/* highest address counted so far by do_counting() */
+	int sweep_valid;			/* sweep_end is set */
+	unsigned int number;			/* position in the list, set by number_shnets() */
 	struct shared_network_t *next;
 };
 
+/*! \struct range_bitmap_t
+ * \brief Occupancy bitmap and fragmentation statistics of an IPv4 range.
+ */
+struct range_bitmap_t {
+	uint64_t *words;			/* two bits per address, lease type plus one or zero */
+	uint32_t free_blocks;			/* runs of addresses that are not active or backup */
+	uint32_t used_blocks;			/* runs of active or backup addresses */
+	uint32_t largest_free;			/* size of the largest free run */
+	uint32_t largest_free_first;		/* first address of the largest free run */
+	uint32_t first_used;			/* lowest active or backup address */
+	uint32_t last_used;			/* highest active or backup address */
+	int has_used;				/* first_used and last_used are valid */
+};
+
 /*! \struct range_t
  * \brief Counters for an individual range.
  */
 struct range_t {
 	struct shared_network_t *shared_net;
+	struct shared_network_t *pool;		/* pool{} block, NULL when not known */
 	union ipaddr_t first_ip;
 	union ipaddr_t last_ip;
+	union ipaddr_t max_last;		/* highest last_ip of this and earlier sorted ranges */
 	double count;
 	double touched;
 	double backups;
+	double growth_rate;
+	double eta;
+	int unchanged;				/* counters same as in previous --changed-only run */
+	uint32_t lease_hist[NUM_OF_LEASE_HIST];
+	struct range_bitmap_t *bitmap;		/* --fragmentation bitmap, or NULL */
+	int prefix_len;				/* prefix6 delegated prefix length, zero for addresses */
+};
+
+/*! \struct tombstone_t
+ * \brief A range or shared network of previous --changed-only run that
+ * does not exist anymore.
+ */
+struct tombstone_t {
+	int is_range;
+	union ipaddr_t first_ip;
+	union ipaddr_t last_ip;
+	char *name;		/* shared network name, empty for ranges */
 };
 
 /*! \struct output_helper_t
@@ -169,6 +259,31 @@ struct leases_t {
 	union ipaddr_t ip;	/* ip as key */
 	enum ltype type;
 	char *ethernet;
+	uint32_t duration;	/* lease time in seconds, zero when not known */
+	int64_t cltt;		/* client last transaction time, zero when not known */
+	struct macs_t *mac;	/* hardware address index entry, or NULL */
+	struct leases_t *mac_next;	/* next lease of the same hardware address */
+	UT_hash_handle hh;
+};
+
+/*! \def SNMP_ROOT_OID
+ * \brief Default root OID of --snmp-pass-persist, same as in contrib/snmptest.pl. */
+# define SNMP_ROOT_OID ".1.3.6.1.4.1.2021.250.255"
+
+/*! \def MAC_LEN
+ * \brief Length of a binary ethernet address.
+ */
+# define MAC_LEN 6
+
+/*! \struct macs_t
+ * \brief Secondary index from client hardware address to its active
+ * leases.  These are hashed as well.
+ */
+struct macs_t {
+	uint8_t mac[MAC_LEN];		/* binary ethernet address as key */
+	unsigned int count;		/* number of active leases */
+	unsigned int ranges;		/* number of ranges the leases are in */
+	struct leases_t *leases;	/* list linked with leases_t mac_next */
 	UT_hash_handle hh;
 };
 
@@ -201,28 +316,103 @@ struct output_sort {
 	struct output_sort *next;
 };
 
+/*! \struct file_stamp
+ * \brief State of dhcpd files at the time of analysis, used by long
+ * running modes to notice changes.
+ */
+struct file_stamp {
+	time_t mtime;		/*!< Newest modification time. */
+	off_t size;		/*!< Sum of file sizes. */
+	int valid;		/*!< Set when there is an analysis of the files. */
+};
+
+/*! \struct parse_stats_t
+ * \brief Input volume counters reported with --stats.
+ */
+struct parse_stats_t {
+	uint64_t conf_bytes;		/*!< Bytes read from dhcpd.conf and include files. */
+	uint64_t lease_bytes;		/*!< Bytes read from dhcpd.leases files. */
+	uint64_t lease_lines;		/*!< Lines read from dhcpd.leases files. */
+	uint64_t lease_records;		/*!< Number of lease, iaaddr, and iaprefix statements. */
+	uint64_t repeated;		/*!< Records of an address that the same file had earlier. */
+	uint64_t lease_skipped;		/*!< Bytes of incomplete records and of replaced files. */
+	uint64_t lease_restarts;	/*!< Times a lease file was replaced during read. */
+};
+
 /*! \struct conf_t
  * \brief Runtime configuration state.
  */
 struct conf_t {
 	struct shared_network_t *shared_net_root;	/*!< First entry in shared network linked list, that is the 'all networks', */
 	struct shared_network_t *shared_net_head;	/*!< Last entry in shared network linked list.  */
+	struct shared_network_t *pools;			/*!< Linked list of pool{} blocks. */
+	struct shared_network_t *classes;		/*!< Linked list of classes pools allow or deny. */
+	unsigned int num_pools;				/*!< Number of entries in pools list. */
 	struct range_t *ranges;				/*!< Array of ranges. */
 	unsigned int num_ranges;			/*!< Number of ranges in the ranges array. */
 	size_t ranges_size;				/*!< Size of the ranges array. */
 	struct leases_t *leases;			/*!< An array of individual leases from dhcpd.leases file. */
+	struct macs_t *macs;				/*!< Hardware address index of active leases. */
+	unsigned int dup_across_ranges;			/*!< Number of clients with active leases in several ranges. */
+	unsigned int dup_in_range;			/*!< Number of clients with several active leases in one range. */
+	unsigned int overlap_ranges;			/*!< Number of ranges that overlap an earlier range. */
+	double overlap_addresses;			/*!< Range addresses already in an earlier range. */
 	enum dhcp_version ip_version;			/*!< Designator if the dhcpd is running in IPv4 or IPv6 mode. */
 	const char *dhcpdconf_file;			/*!< Path to dhcpd.conf file. */
 	const char *dhcpdlease_file;			/*!< Path to dhcpd.leases file. */
+	const char **lease_files;			/*!< Paths of all dhcpd.leases files to be merged. */
+	unsigned int num_lease_files;			/*!< Number of entries in lease_files array. */
+	char **include_files;				/*!< Paths of files included by dhcpd.conf. */
+	unsigned int num_include_files;			/*!< Number of entries in include_files array. */
+	struct file_stamp include_stamp;		/*!< State of include files when they were parsed. */
+	enum merge_rule merge_rule;			/*!< How to choose between leases of multiple files. */
 	int output_format;				/*!< Column to use in color_tags array. */
 	struct output_sort *sorts;			/*!< Linked list how to sort ranges. */
 	const char *output_file;			/*!< Output file path. */
+	FILE *output_stream;				/*!< Stream that output writers use and close instead of output_file. */
 	const char *mustach_template;			/*!< Mustach template file path. */
 	double warning;					/*!< Warning percent threshold. */
 	double critical;				/*!< Critical percent threshold. */
 	double warn_count;				/*!< Maximum number of free IP's before warning. */
 	double crit_count;				/*!< Maximum number of free IP's before critical. */
 	double minsize;					/*!< Minimum size of range or shared network to be considered exceeding threshold. */
+	const char *history_file;			/*!< Path to usage history ring file. */
+	unsigned int history_retention;			/*!< Number of samples kept in a new history file. */
+	time_t history_window;				/*!< Seconds of history to print in --history-query mode. */
+	const char *history_select;			/*!< Range or shared network to print in --history-query mode. */
+	const char *forecast_file;			/*!< Path to growth statistics state file. */
+	double warn_eta;				/*!< Seconds to exhaustion before warning. */
+	double crit_eta;				/*!< Seconds to exhaustion before critical. */
+	const char *index_file;				/*!< Path to address lookup index file. */
+	const char *benchmark_file;			/*!< Path to benchmark results file. */
+	const char *snmp_root;				/*!< Root OID of snmpd pass_persist mode. */
+	const char *listen;				/*!< Address of http metrics listener. */
+	const char *shm_name;				/*!< Shared memory segment to publish counters. */
+	struct dhcpd_pools_shm_header *shm_map;		/*!< Mapping of the segment, NULL when not open. */
+	size_t shm_size;				/*!< Bytes mapped. */
+	int shm_fd;					/*!< Segment file descriptor. */
+	const char *manifest_file;			/*!< List of dhcpd instances to analyze. */
+	unsigned int num_jobs;				/*!< Threads of manifest mode, zero is number of cpus. */
+	const char *changed_file;			/*!< Path to --changed-only state file. */
+	struct tombstone_t *tombstones;			/*!< Removed ranges and shared networks. */
+	unsigned int num_tombstones;			/*!< Number of entries in tombstones array. */
+	const char *events_file;			/*!< Path to lease state snapshot of --events. */
+	time_t replay_interval;				/*!< Bucket width of --replay, zero when not replaying. */
+	time_t replay_bucket;				/*!< End of the current replay bucket, zero before first time stamp. */
+	FILE *replay_stream;				/*!< Replay output. */
+	char replay_format;				/*!< Replay output format. */
+	unsigned long replay_rows;			/*!< Number of rows printed by replay. */
+	struct decompress_t *decompress;		/*!< Decompressor of the lease file being parsed. */
+	const char *only_shared;			/*!< Shared network selected with --only-shared. */
+	union ipaddr_t only_first;			/*!< First address of --only-net network. */
+	union ipaddr_t only_last;			/*!< Last address of --only-net network. */
+	size_t memory_limit;				/*!< Lease table size in bytes before spilling to disk. */
+	struct spill_t *spill;				/*!< Spilled leases, NULL when the hash holds them. */
+	struct timespec bench_clock;			/*!< End of previous phase. */
+	struct timespec bench_cpu;			/*!< Process cpu time at end of previous phase. */
+	double phase_time[NUM_OF_PHASES];		/*!< Seconds spent in each phase. */
+	double phase_cpu[NUM_OF_PHASES];		/*!< Cpu seconds spent in each phase. */
+	struct parse_stats_t stats;			/*!< Input volume counters. */
 	unsigned int
 		reverse_order:1,			/*!< Reverse sort order. */
 		backups_found:1,			/*!< Indicator if dhcpd.leases file has leases in backup state. */
@@ -236,34 +426,91 @@ struct conf_t {
 		skip_critical:1,			/*!< Skip critical values from output. */
 		skip_minsize:1,				/*!< Skip alarming values that are below minsize from output. */
 		skip_suppressed:1,			/*!< Skip alarming values that are suppressed with --snet-alarms option, or they are shared networks without IP availability. */
+		lease_histogram:1,			/*!< Collect lease time histograms. */
+		history_query:1,			/*!< Print history instead of analysing dhcpd files. */
+		lease_times:1,				/*!< Parse lease time stamps from dhcpd.leases file. */
+		duplicates:1,				/*!< Report clients that have more than one active lease. */
+		overlap_warned:1,			/*!< Overlapping ranges were reported on stderr. */
+		lookup:1,				/*!< Look up addresses instead of analysing pools. */
+		only_net:1,				/*!< Keep only ranges that overlap with only_first and only_last. */
+		fragmentation:1,			/*!< Collect IPv4 range occupancy bitmaps. */
+		pool_counting:1,			/*!< Count pools and classes in addition to shared networks. */
+		print_stats:1,				/*!< Report phase timings and resource usage. */
 		color_mode:2;				/*!< Indicator if colors should be used in output. */
 };
 
 /* Function prototypes */
 
 /* analyze.c */
+extern void sort_ranges(struct conf_t *state);
 extern void prepare_data(struct conf_t *state);
 extern void do_counting(struct conf_t *state);
+extern void count_duplicates(struct conf_t *state);
+extern struct range_t *find_range(struct conf_t *state, const union ipaddr_t *ip);
+extern void file_stamp_add(struct file_stamp *stamp, const struct stat *st);
+extern int refresh_analysis(struct conf_t *state, struct file_stamp *stamp,
+			    const int print_mac_addreses);
+
+/* benchmark.c */
+extern void bench_start(struct conf_t *state);
+extern void bench_mark(struct conf_t *state, enum bench_phase phase);
+extern void bench_write(struct conf_t *state);
+extern void stats_print(struct conf_t *state, FILE *f, const int json);
+
+/* bitmap.c */
+extern void bitmap_init(struct conf_t *state);
+extern void bitmap_mark(struct range_t *range_p, const union ipaddr_t *ip, enum ltype type);
+extern void bitmap_analyze(struct range_t *range_p);
+extern void bitmap_free(struct conf_t *state);
+
+/* decompress.c */
+extern FILE *lease_file_open(struct conf_t *state, const char *path);
+extern int lease_file_close(struct conf_t *state, FILE *f);
+
+/* delta.c */
+extern void delta_update(struct conf_t *state);
+
+/* events.c */
+extern int events_run(struct conf_t *state);
+
+/* forecast.c */
+extern void forecast_update(struct conf_t *state);
 
 /* getdata.c */
 extern int parse_leases(struct conf_t *state, const int print_mac_addreses);
+extern void parse_lease_files(struct conf_t *state, const int print_mac_addreses);
 extern void parse_config(struct conf_t *state, const int is_include,
 			 const char *restrict config_file,
 			 struct shared_network_t *restrict shared_p);
 
+/* history.c */
+extern void history_append(struct conf_t *state);
+extern int history_query(struct conf_t *state, const char output_format);
+
+/* lookup.c */
+extern void lookup_write(struct conf_t *state);
+extern int lookup_query(struct conf_t *state, const char output_format, char **addrs,
+			int num_addrs);
+
 /* hash.c */
-extern void (*add_lease) (struct conf_t *state, union ipaddr_t *addr, enum ltype type);
-extern void add_lease_init(struct conf_t *state, union ipaddr_t *addr, enum ltype type);
-extern void add_lease_v4(struct conf_t *state, union ipaddr_t *addr, enum ltype type);
-extern void add_lease_v6(struct conf_t *state, union ipaddr_t *addr, enum ltype type);
+extern THREAD_LOCAL struct leases_t *(*add_lease) (struct conf_t *state, union ipaddr_t *addr, enum ltype type);
+extern struct leases_t *add_lease_init(struct conf_t *state, union ipaddr_t *addr, enum ltype type);
+extern struct leases_t *add_lease_v4(struct conf_t *state, union ipaddr_t *addr, enum ltype type);
+extern struct leases_t *add_lease_v6(struct conf_t *state, union ipaddr_t *addr, enum ltype type);
 
-extern struct leases_t *(*find_lease) (struct conf_t *state, union ipaddr_t *addr);
+extern THREAD_LOCAL struct leases_t *(*find_lease) (struct conf_t *state, union ipaddr_t *addr);
 extern struct leases_t *find_lease_init(struct conf_t *state, union ipaddr_t *addr);
 extern struct leases_t *find_lease_v4(struct conf_t *state, union ipaddr_t *addr);
 extern struct leases_t *find_lease_v6(struct conf_t *state, union ipaddr_t *addr);
 
 extern void delete_lease(struct conf_t *state, struct leases_t *lease);
 extern void delete_all_leases(struct conf_t *state);
+extern void merge_leases(struct conf_t *state, struct leases_t **from);
+extern void add_mac(struct conf_t *state, struct leases_t *lease);
+extern const char *ntop_mac(const uint8_t *mac);
+
+/* manifest.c */
+extern int manifest_run(struct conf_t *state, const char output_format);
 
 /* mustach-dhcpd-pools.c */
 extern int mustach_dhcpd_pools(struct conf_t *state);
@@ -271,15 +518,20 @@ extern int mustach_dhcpd_pools(struct conf_t *state);
 /* other.c */
 extern void set_ipv_functions(struct conf_t *state, int version);
 extern void flip_ranges(struct conf_t *state);
+extern unsigned int number_shnets(struct conf_t *state);
+extern void prepare_memory(struct conf_t *state);
+extern void reset_analysis(struct conf_t *state);
 extern void clean_up(struct conf_t *state);
 extern void parse_cidr(struct conf_t *state, struct range_t *range_p, const char *word);
+extern void parse_prefix_len(struct range_t *range_p, const char *word);
 extern int parse_color_mode(const char *restrict optarg);
 extern double strtod_or_err(const char *restrict str, const char *restrict errmesg);
 extern void __attribute__ ((noreturn)) print_version(void);
 extern void __attribute__ ((noreturn)) usage(int status);
 extern void dp_time_tool(FILE *file, const char *path, int epoch);
+extern void dp_time_print(FILE *file, time_t t, int epoch);
 
-extern int (*parse_ipaddr) (struct conf_t *state, const char *restrict src,
+extern THREAD_LOCAL int (*parse_ipaddr) (struct conf_t *state, const char *restrict src,
 			    union ipaddr_t *restrict dst);
 extern int parse_ipaddr_init(struct conf_t *state, const char *restrict src,
 			     union ipaddr_t *restrict dst);
@@ -288,22 +540,22 @@ extern int parse_ipaddr_v4(struct conf_t *state, const char *restrict src,
 extern int parse_ipaddr_v6(struct conf_t *state, const char *restrict src,
 			   union ipaddr_t *restrict dst);
 
-extern int (*xstrstr) (struct conf_t *state, const char *restrict str);
+extern THREAD_LOCAL int (*xstrstr) (struct conf_t *state, const char *restrict str);
 extern int xstrstr_init(struct conf_t *state, const char *restrict str);
 extern int xstrstr_v4(struct conf_t *state, const char *restrict str);
 extern int xstrstr_v6(struct conf_t *state, const char *restrict str);
 
-extern void (*copy_ipaddr) (union ipaddr_t *restrict dst, const union ipaddr_t *restrict src);
+extern THREAD_LOCAL void (*copy_ipaddr) (union ipaddr_t *restrict dst, const union ipaddr_t *restrict src);
 extern void copy_ipaddr_init(union ipaddr_t *restrict dst, const union ipaddr_t *restrict src);
 extern void copy_ipaddr_v4(union ipaddr_t *restrict dst, const union ipaddr_t *restrict src);
 extern void copy_ipaddr_v6(union ipaddr_t *restrict dst, const union ipaddr_t *restrict src);
 
-extern const char *(*ntop_ipaddr) (const union ipaddr_t *ip);
+extern THREAD_LOCAL const char *(*ntop_ipaddr) (const union ipaddr_t *ip);
 extern const char *ntop_ipaddr_init(const union ipaddr_t *ip);
 extern const char *ntop_ipaddr_v4(const union ipaddr_t *ip);
 extern const char *ntop_ipaddr_v6(const union ipaddr_t *ip);
 
-extern double (*get_range_size) (const struct range_t *r);
+extern THREAD_LOCAL double (*get_range_size) (const struct range_t *r);
 extern double get_range_size_init(const struct range_t *r);
 extern double get_range_size_v4(const struct range_t *r);
 extern double get_range_size_v6(const struct range_t *r);
@@ -314,20 +566,43 @@ extern int range_output_helper(struct conf_t *state, struct output_helper_t *oh,
 extern int shnet_output_helper(struct conf_t *state, struct output_helper_t *oh,
 			       struct shared_network_t *shared_p);
 extern int output_analysis(struct conf_t *state, const char output_format);
+extern void output_lease_hist(FILE *f, const uint32_t *hist);
+extern void output_lease_hist_bounds(FILE *f);
+
+/* http.c */
+extern int http_serve(struct conf_t *state);
+
+/* replay.c */
+extern void replay_lease(struct conf_t *state, const union ipaddr_t *addr, int prev,
+			 enum ltype type, int64_t t);
+extern int replay_run(struct conf_t *state, const char output_format);
+
+/* shm.c */
+extern void shm_publish(struct conf_t *state);
+extern void shm_detach(struct conf_t *state);
+
+/* spill.c */
+extern void spill_lease(struct conf_t *state, const union ipaddr_t *addr, enum ltype type);
+extern int spill_check(struct conf_t *state);
+extern void spill_count(struct conf_t *state);
+extern void spill_free(struct conf_t *state);
+
+/* snmp.c */
+extern int snmp_pass_persist(struct conf_t *state);
 
 /* sort.c */
 extern void mergesort_ranges(struct conf_t *state,
 			     struct range_t *restrict orig, unsigned int size,
 			     struct range_t *restrict temp, const int root_call);
 
-extern int (*leasecomp) (const struct leases_t *restrict a, const struct leases_t *restrict b);
+extern THREAD_LOCAL int (*leasecomp) (const struct leases_t *restrict a, const struct leases_t *restrict b);
 extern int leasecomp_init(const struct leases_t *restrict a
 			  __attribute__ ((unused)),
 			  const struct leases_t *restrict b __attribute__ ((unused)));
 extern int leasecomp_v4(const struct leases_t *restrict a, const struct leases_t *restrict b);
 extern int leasecomp_v6(const struct leases_t *restrict a, const struct leases_t *restrict b);
 
-extern int (*ipcomp) (const union ipaddr_t *restrict a, const union ipaddr_t *restrict b);
+extern THREAD_LOCAL int (*ipcomp) (const union ipaddr_t *restrict a, const union ipaddr_t *restrict b);
 extern int ipcomp_init(const union ipaddr_t *restrict a, const union ipaddr_t *restrict b);
 extern int ipcomp_v4(const union ipaddr_t *restrict a, const union ipaddr_t *restrict b);
 extern int ipcomp_v6(const union ipaddr_t *restrict a, const union ipaddr_t *restrict b);
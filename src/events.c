@@ -0,0 +1,268 @@
+/*
+ * The dhcpd-pools has BSD 2-clause license which also known as "Simplified
+ * BSD License" or "FreeBSD License".
+ *
+ * Copyright 2006- Sami Kerola. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the
+ *       distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR AND CONTRIBUTORS OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing
+ * official policies, either expressed or implied, of Sami Kerola.
+ */
+
+
+/*! \file events.c
+ * \brief Lease state transition events between runs.
+ *
+ * The final lease states are saved to a snapshot file, which is a header
+ * and an array of fixed size lease records sorted by address.  At next
+ * run the previous snapshot is mapped to memory, and merged with the
+ * address ordered lease hash, so the comparison costs one pass over both
+ * and the old lease file is never parsed again.  Every address whose
+ * state or hardware address changed is printed as a json object on a line
+ * of its own.  The snapshot uses host byte order and is not portable
+ * between machines.
+ */
+
+#include <config.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "close-stream.h"
+#include "error.h"
+#include "xalloc.h"
+
+#include "dhcpd-pools.h"
+
+/*! \def EVENTS_MAGIC
+ * \brief Snapshot file identifier, including format version.
+ */
+#define EVENTS_MAGIC "DPEVNT01"
+
+/*! \struct events_header
+ * \brief The snapshot file header.
+ */
+struct events_header {
+	char magic[8];
+	uint32_t ip_version;		/*!< The dhcp_version of the leases. */
+	uint32_t pad;
+	uint64_t num_leases;		/*!< Number of events_lease records. */
+};
+
+/*! \struct events_lease
+ * \brief State of a lease in the snapshot.
+ */
+struct events_lease {
+	union ipaddr_t ip;
+	int64_t cltt;			/*!< Client last transaction time, zero when not known. */
+	uint8_t mac[MAC_LEN];
+	uint8_t type;			/*!< The ltype of the lease. */
+	uint8_t has_mac;
+};
+
+/*! \brief Map previous snapshot to memory.
+ * \return Pointer to header, or NULL when there is no usable snapshot. */
+static struct events_header *events_map(struct conf_t *state, size_t *size)
+{
+	struct events_header *hdr;
+	struct stat st;
+	int fd;
+
+	fd = open(state->events_file, O_RDONLY);
+	if (fd < 0) {
+		if (errno == ENOENT)
+			return NULL;
+		error(EXIT_FAILURE, errno, "events_map: %s", state->events_file);
+	}
+	if (fstat(fd, &st))
+		error(EXIT_FAILURE, errno, "events_map: %s", state->events_file);
+	if ((size_t)st.st_size < sizeof(struct events_header)) {
+		close(fd);
+		return NULL;
+	}
+	*size = st.st_size;
+	hdr = mmap(NULL, *size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (hdr == MAP_FAILED)
+		error(EXIT_FAILURE, errno, "events_map: mmap %s", state->events_file);
+	if (memcmp(hdr->magic, EVENTS_MAGIC, sizeof(hdr->magic))
+	    || *size != sizeof(struct events_header) + hdr->num_leases * sizeof(struct events_lease))
+		error(EXIT_FAILURE, 0, "events_map: %s: not an events snapshot", state->events_file);
+	/* ip version change makes the previous snapshot meaningless */
+	if (hdr->ip_version != (uint32_t)state->ip_version) {
+		munmap(hdr, *size);
+		return NULL;
+	}
+	return hdr;
+}
+
+/*! \brief Convert a lease to a snapshot record. */
+static void events_record(struct events_lease *e, const struct leases_t *l)
+{
+	memset(e, 0, sizeof(struct events_lease));
+	copy_ipaddr(&e->ip, &l->ip);
+	e->cltt = l->cltt;
+	e->type = l->type;
+	if (l->ethernet
+	    && sscanf(l->ethernet, "%2hhx:%2hhx:%2hhx:%2hhx:%2hhx:%2hhx",
+		      &e->mac[0], &e->mac[1], &e->mac[2], &e->mac[3], &e->mac[4],
+		      &e->mac[5]) == MAC_LEN)
+		e->has_mac = 1;
+}
+
+/*! \brief Printable lease state. */
+static const char *events_state(const struct events_lease *e)
+{
+	if (e == NULL)
+		return "none";
+	switch (e->type) {
+	case ACTIVE:
+		return "active";
+	case FREE:
+		return "free";
+	case BACKUP:
+		return "backup";
+	default:
+		return "unknown";
+	}
+}
+
+/*! \brief Print an event if state or hardware address changed.
+ * \param old Previous record, or NULL when address is new.
+ * \param cur Current record, or NULL when address disappeared.
+ * \param now Time of events that have no client last transaction time. */
+static void events_compare(FILE *f, const struct events_lease *old,
+			   const struct events_lease *cur, int64_t now)
+{
+	const struct events_lease *e = cur ? cur : old;
+	int mac_changed;
+
+	mac_changed = old && cur && (old->has_mac != cur->has_mac
+				     || memcmp(old->mac, cur->mac, MAC_LEN));
+	if (old && cur && old->type == cur->type && !mac_changed)
+		return;
+	fprintf(f, "{\"time\":%lld,\"ip\":\"%s\",\"from\":\"%s\",\"to\":\"%s\"",
+		(long long)(cur && cur->cltt ? cur->cltt : now), ntop_ipaddr(&e->ip),
+		events_state(old), events_state(cur));
+	if (e->has_mac)
+		fprintf(f, ",\"mac\":\"%s\"", ntop_mac(e->mac));
+	if (mac_changed && old->has_mac)
+		fprintf(f, ",\"previous_mac\":\"%s\"", ntop_mac(old->mac));
+	fputs("}\n", f);
+}
+
+/*! \brief Save the current leases as the next snapshot.  The file is
+ * replaced atomically. */
+static void events_save(struct conf_t *state, const struct events_lease *cur, uint64_t num)
+{
+	struct events_header hdr = { .ip_version = state->ip_version, .num_leases = num };
+	char *tmpname;
+	FILE *out;
+
+	memcpy(hdr.magic, EVENTS_MAGIC, sizeof(hdr.magic));
+
+	tmpname = xmalloc(strlen(state->events_file) + sizeof(".tmp"));
+	sprintf(tmpname, "%s.tmp", state->events_file);
+	out = fopen(tmpname, "w");
+	if (out == NULL)
+		error(EXIT_FAILURE, errno, "events_save: %s", tmpname);
+	if (fwrite(&hdr, sizeof(hdr), 1, out) != 1
+	    || (num && fwrite(cur, sizeof(struct events_lease), num, out) != num))
+		error(EXIT_FAILURE, errno, "events_save: %s", tmpname);
+	if (close_stream(out))
+		error(EXIT_FAILURE, errno, "events_save: %s", tmpname);
+	if (rename(tmpname, state->events_file))
+		error(EXIT_FAILURE, errno, "events_save: rename %s", state->events_file);
+	free(tmpname);
+}
+
+/*! \brief Print lease state transitions since the previous run, and save
+ * the current state for the next run.  The first run saves the snapshot
+ * without printing events.
+ * \return Exit value. */
+int events_run(struct conf_t *state)
+{
+	struct events_header *hdr;
+	struct events_lease *cur, *old;
+	struct leases_t *l;
+	uint64_t num_cur, i, j;
+	size_t size = 0;
+	int64_t now = time(NULL);
+	FILE *outfile;
+	int cmp;
+
+	parse_config(state, 1, state->dhcpdconf_file, state->shared_net_root);
+	parse_lease_files(state, 1);
+	/* sorts the lease hash by address */
+	prepare_data(state);
+	num_cur = HASH_COUNT(state->leases);
+	cur = xmalloc(sizeof(struct events_lease) * (num_cur ? num_cur : 1));
+	for (i = 0, l = state->leases; l; l = l->hh.next, i++)
+		events_record(cur + i, l);
+	hdr = events_map(state, &size);
+
+	if (state->output_file) {
+		outfile = fopen(state->output_file, "w+");
+		if (outfile == NULL)
+			error(EXIT_FAILURE, errno, "events_run: %s", state->output_file);
+	} else
+		outfile = stdout;
+	if (hdr) {
+		old = (struct events_lease *)(hdr + 1);
+		for (i = 0, j = 0; i < hdr->num_leases || j < num_cur;) {
+			if (i == hdr->num_leases)
+				cmp = 1;
+			else if (j == num_cur)
+				cmp = -1;
+			else
+				cmp = ipcomp(&old[i].ip, &cur[j].ip);
+			if (cmp < 0)
+				events_compare(outfile, old + i++, NULL, now);
+			else if (0 < cmp)
+				events_compare(outfile, NULL, cur + j++, now);
+			else
+				events_compare(outfile, old + i++, cur + j++, now);
+		}
+		munmap(hdr, size);
+	}
+	if (outfile == stdout) {
+		if (fflush(stdout))
+			error(EXIT_FAILURE, errno, "events_run: fflush");
+	} else if (close_stream(outfile))
+		error(EXIT_FAILURE, errno, "events_run: fclose");
+	events_save(state, cur, num_cur);
+	free(cur);
+	return 0;
+}
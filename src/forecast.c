@@ -0,0 +1,218 @@
+/*
+ * The dhcpd-pools has BSD 2-clause license which also known as "Simplified
+ * BSD License" or "FreeBSD License".
+ *
+ * Copyright 2006- Sami Kerola. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the
+ *       distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR AND CONTRIBUTORS OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing
+ * official policies, either expressed or implied, of Sami Kerola.
+ */
+
+
+/*! \file forecast.c
+ * \brief Pool exhaustion forecasting.
+ *
+ * Growth of used addresses is tracked with an exponentially weighted
+ * moving average that is updated once per run.  The state is one fixed size
+ * record per range and shared network, which is read to a hash at start,
+ * and written back after counting.
+ */
+
+#include <config.h>
+
+#include <errno.h>
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "close-stream.h"
+#include "error.h"
+#include "xalloc.h"
+
+#include "dhcpd-pools.h"
+
+/*! \def FORECAST_MAGIC
+ * \brief Forecast state file identifier, including format version.
+ */
+#define FORECAST_MAGIC "DPFCST01"
+
+/*! \def FORECAST_TAU
+ * \brief Time constant, in seconds, of the growth rate moving average.
+ */
+#define FORECAST_TAU 3600.0
+
+/*! \struct forecast_t
+ * \brief Persisted growth statistics of a range or shared network.  The
+ * fields before 'time' are the hash key.
+ */
+struct forecast_t {
+	uint32_t is_range;
+	uint32_t pad;
+	union ipaddr_t first_ip;
+	union ipaddr_t last_ip;
+	char name[64];
+	int64_t time;			/*!< When used was sampled. */
+	double used;			/*!< Number of used addresses. */
+	double rate;			/*!< Moving average of used growth per second. */
+	UT_hash_handle hh;
+};
+
+/*! \def FORECAST_KEYLEN
+ * \brief Length of forecast_t hash key.
+ */
+#define FORECAST_KEYLEN offsetof(struct forecast_t, time)
+
+/*! \def FORECAST_RECLEN
+ * \brief Length of forecast_t in the state file.
+ */
+#define FORECAST_RECLEN offsetof(struct forecast_t, hh)
+
+/*! \brief Read forecast state file to a hash.
+ * \return Hash of previous run growth statistics. */
+static struct forecast_t *forecast_read(struct conf_t *state)
+{
+	FILE *f;
+	char magic[8];
+	struct forecast_t *head = NULL, *fc;
+
+	f = fopen(state->forecast_file, "r");
+	if (f == NULL) {
+		if (errno == ENOENT)
+			return NULL;
+		error(EXIT_FAILURE, errno, "forecast_read: %s", state->forecast_file);
+	}
+	if (fread(magic, sizeof(magic), 1, f) != 1 || memcmp(magic, FORECAST_MAGIC, sizeof(magic)))
+		error(EXIT_FAILURE, 0, "forecast_read: %s: not a forecast file", state->forecast_file);
+	while (1) {
+		fc = xmalloc(sizeof(struct forecast_t));
+		if (fread(fc, FORECAST_RECLEN, 1, f) != 1) {
+			free(fc);
+			break;
+		}
+		HASH_ADD(hh, head, is_range, FORECAST_KEYLEN, fc);
+	}
+	if (ferror(f))
+		error(EXIT_FAILURE, errno, "forecast_read: %s", state->forecast_file);
+	fclose(f);
+	return head;
+}
+
+/*! \brief Update growth statistics of a range or shared network.
+ * \param prev Hash of previous run statistics.
+ * \param key Record with key fields set.
+ * \param used Current number of used addresses.
+ * \param available Size of the range or shared network.
+ * \param rate Pointer where the growth rate is stored.
+ * \param eta Pointer where the time to exhaustion is stored.
+ * \param out State file being written.
+ */
+static void forecast_one(struct forecast_t *prev, struct forecast_t *key, double used,
+			 double available, double *rate, double *eta, FILE *out)
+{
+	struct forecast_t *fc;
+
+	key->used = used;
+	key->rate = 0;
+	HASH_FIND(hh, prev, key, FORECAST_KEYLEN, fc);
+	if (fc && fc->time < key->time) {
+		double dt = key->time - fc->time;
+		double alpha = 1 - exp(-dt / FORECAST_TAU);
+
+		key->rate = alpha * ((used - fc->used) / dt) + (1 - alpha) * fc->rate;
+	} else if (fc) {
+		/* Ran twice within a second, keep earlier sample. */
+		key->time = fc->time;
+		key->used = fc->used;
+		key->rate = fc->rate;
+	}
+	*rate = key->rate;
+	if (available <= used)
+		*eta = 0;
+	else if (fc == NULL)
+		*eta = NAN;
+	else if (key->rate <= 0)
+		*eta = INFINITY;
+	else
+		*eta = (available - used) / key->rate;
+	if (fwrite(key, FORECAST_RECLEN, 1, out) != 1)
+		error(EXIT_FAILURE, errno, "forecast_one: write");
+}
+
+/*! \brief Update growth statistics and time to exhaustion estimates of
+ * ranges and shared networks, and save statistics for the next run. */
+void forecast_update(struct conf_t *state)
+{
+	struct forecast_t *prev, *fc, key;
+	struct range_t *range_p;
+	struct shared_network_t *shared_p;
+	unsigned int i;
+	char *tmpname;
+	FILE *out;
+	time_t now = time(NULL);
+
+	prev = forecast_read(state);
+	tmpname = xmalloc(strlen(state->forecast_file) + sizeof(".tmp"));
+	sprintf(tmpname, "%s.tmp", state->forecast_file);
+	out = fopen(tmpname, "w");
+	if (out == NULL)
+		error(EXIT_FAILURE, errno, "forecast_update: %s", tmpname);
+	if (fwrite(FORECAST_MAGIC, 8, 1, out) != 1)
+		error(EXIT_FAILURE, errno, "forecast_update: %s", tmpname);
+	for (i = 0, range_p = state->ranges; i < state->num_ranges; i++, range_p++) {
+		memset(&key, 0, sizeof(key));
+		key.is_range = 1;
+		copy_ipaddr(&key.first_ip, &range_p->first_ip);
+		copy_ipaddr(&key.last_ip, &range_p->last_ip);
+		snprintf(key.name, sizeof(key.name), "%s", range_p->shared_net->name);
+		key.time = now;
+		forecast_one(prev, &key, range_p->count, get_range_size(range_p),
+			     &range_p->growth_rate, &range_p->eta, out);
+	}
+	for (shared_p = state->shared_net_root; shared_p; shared_p = shared_p->next) {
+		memset(&key, 0, sizeof(key));
+		snprintf(key.name, sizeof(key.name), "%s", shared_p->name);
+		key.time = now;
+		forecast_one(prev, &key, shared_p->used, shared_p->available,
+			     &shared_p->growth_rate, &shared_p->eta, out);
+	}
+	if (close_stream(out))
+		error(EXIT_FAILURE, errno, "forecast_update: %s", tmpname);
+	if (rename(tmpname, state->forecast_file))
+		error(EXIT_FAILURE, errno, "forecast_update: rename %s", state->forecast_file);
+	free(tmpname);
+	while (prev) {
+		fc = prev;
+		HASH_DEL(prev, fc);
+		free(fc);
+	}
+}
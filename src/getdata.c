@@ -43,13 +43,19 @@
 #include <ctype.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <math.h>
 #include <netinet/in.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <sys/stat.h>
 
+#ifdef HAVE_PTHREAD
+# include <pthread.h>
+#endif
+
 #include "error.h"
 #include "xalloc.h"
 
@@ -74,28 +80,108 @@ enum isc_conf_parser {
 	ITS_A_SHAREDNET,
 	ITS_AN_INCLUDE,
 	ITS_A_SUBNET,
-	ITS_A_NETMASK
+	ITS_A_NETMASK,
+	ITS_A_POOL,
+	ITS_AN_ALLOW,
+	ITS_A_DENY,
+	ITS_A_PREFIX_FIRST_IP,
+	ITS_A_PREFIX_SECOND_IP,
+	ITS_A_PREFIX_LENGTH
 };
 
+/*! \brief Convert a dhcpd.leases time stamp to seconds since epoch.
+ * Both the default 'W YYYY/MM/DD HH:MM:SS' UTC format and the 'db-time-format
+ * local' style 'epoch NNN' format are understood.
+ * \param s Time stamp string after starts, ends, or cltt keyword.
+ * \return Seconds since epoch, -1 when time is 'never', or 0 on failure. */
+static int64_t parse_lease_time(const char *restrict s)
+{
+	int wday, year, mon, mday, hour, min, sec;
+	long long epoch;
+	int64_t days;
+
+	if (!strncmp(s, "never", 5))
+		return -1;
+	if (sscanf(s, "epoch %lld", &epoch) == 1)
+		return epoch;
+	if (sscanf(s, "%d %d/%d/%d %d:%d:%d", &wday, &year, &mon, &mday,
+		   &hour, &min, &sec) != 7)
+		return 0;
+	/* Days from civil, proleptic Gregorian calendar. */
+	year -= mon <= 2;
+	days = (int64_t)(year / 400) * 146097;
+	year %= 400;
+	mon = (mon + 9) % 12;
+	days += 365 * year + year / 4 - year / 100 + (153 * mon + 2) / 5 + mday - 1 - 719468;
+	return days * 86400 + hour * 3600 + min * 60 + sec;
+}
+
+/*! \brief Calculate lease time out of start and end time stamps.
+ * \return Lease time in seconds, UINT32_MAX for infinite leases, or zero
+ * when it cannot be known. */
+static uint32_t lease_duration(int64_t starts, int64_t ends)
+{
+	if (ends < 0)
+		return UINT32_MAX;
+	if (starts <= 0 || ends <= starts)
+		return 0;
+	if (UINT32_MAX < ends - starts)
+		return UINT32_MAX;
+	return ends - starts;
+}
+
+/*! \brief Replace state of an address with a new lease.
+ * \param t Time stamp of the lease record for replay, zero when not known.
+ * \return The new lease. */
+static struct leases_t *bind_lease(struct conf_t *state, union ipaddr_t *addr,
+				   enum ltype type, uint32_t duration, int64_t cltt, int64_t t)
+{
+	struct leases_t *lease;
+	int prev = -1;
+
+	if (state->spill) {
+		spill_lease(state, addr, type);
+		return NULL;
+	}
+	/* remove old entry, if exists */
+	if ((lease = find_lease(state, addr)) != NULL) {
+		prev = lease->type;
+		delete_lease(state, lease);
+		state->stats.repeated++;
+	}
+	if (state->replay_interval)
+		replay_lease(state, addr, prev, type, t);
+	lease = add_lease(state, addr, type);
+	lease->duration = duration;
+	lease->cltt = cltt;
+	if (state->memory_limit && spill_check(state))
+		/* the lease moved to spill buffer */
+		return NULL;
+	return lease;
+}
+
+/*! \def LEASE_FILE_RETRIES
+ * \brief Maximum number of times parsing is restarted when dhcpd replaces
+ * the lease file while it is read.
+ */
+#define LEASE_FILE_RETRIES 3
+
 /*! \brief Lease file parser.  The parser can only read ISC DHCPD
- * dhcpd.leases file format.  */
-int parse_leases(struct conf_t *state, const int print_mac_addreses)
+ * dhcpd.leases file format.
+ * \return Non-zero when the file was replaced while it was read. */
+static int parse_lease_file(struct conf_t *state, const int print_mac_addreses)
 {
 	FILE *dhcpd_leases;
 	char *line, *ipstring, macstring[20], *stop;
 	union ipaddr_t addr;
 	struct stat lease_file_stats;
-	struct leases_t *lease;
+	struct leases_t *lease, *current = NULL;
+	int64_t starts = 0, ends = 0, cltt = 0;
+	uint32_t duration = 0;
+	const int filter = state->only_net || state->only_shared;
+	int prefix, skip = 0;
 
-	dhcpd_leases = fopen(state->dhcpdlease_file, "r");
-	if (dhcpd_leases == NULL)
-		error(EXIT_FAILURE, errno, "parse_leases: %s", state->dhcpdlease_file);
-#ifdef HAVE_POSIX_FADVISE
-# ifdef POSIX_FADV_SEQUENTIAL
-	if (posix_fadvise(fileno(dhcpd_leases), 0, 0, POSIX_FADV_SEQUENTIAL) != 0)
-		error(EXIT_FAILURE, errno, "parse_leases: fadvise %s", state->dhcpdlease_file);
-# endif				/* POSIX_FADV_SEQUENTIAL */
-#endif				/* HAVE_POSIX_FADVISE */
+	dhcpd_leases = lease_file_open(state, state->dhcpdlease_file);
 	/* I found out that there's one lease address per 300 bytes in
 	 * dhcpd.leases file. Malloc is little bit pessimistic and uses 250.
 	 * If someone has higher density in lease file I'm interested to
@@ -109,47 +195,87 @@ int parse_leases(struct conf_t *state, const int print_mac_addreses)
 	while (!feof(dhcpd_leases)) {
 		if (!fgets(line, MAXLEN, dhcpd_leases) && ferror(dhcpd_leases))
 			error(EXIT_FAILURE, errno, "parse_leases: %s", state->dhcpdlease_file);
-		switch (xstrstr(state, line)) {
+		state->stats.lease_lines++;
+		prefix = xstrstr(state, line);
+		/* IPv6 cltt belongs to the next ia, which may be selected */
+		if (skip && prefix != PREFIX_LEASE && prefix != PREFIX_IAPREFIX
+		    && prefix != PREFIX_CLTT)
+			continue;
+		switch (prefix) {
 			/* It's a lease, save IP */
 		case PREFIX_LEASE:
+		case PREFIX_IAPREFIX:
 			stop =
 			    memccpy(ipstring,
-				    line + (state->ip_version ==
-					    IPv4 ? 6 : 9), ' ', strlen(line));
+				    line + (state->ip_version == IPv4 ? 6 :
+					    prefix == PREFIX_LEASE ? 9 : 11), ' ', strlen(line));
 			if (stop != NULL) {
 				--stop;
 				*stop = '\0';
 			}
+			/* delegated prefix is counted by its first address */
+			if (prefix == PREFIX_IAPREFIX && (stop = strchr(ipstring, '/')) != NULL)
+				*stop = '\0';
 			parse_ipaddr(state, ipstring, &addr);
+			state->stats.lease_records++;
+			/* leases outside of selected ranges are not stored */
+			skip = filter && find_range(state, &addr) == NULL;
+			current = NULL;
+			starts = ends = 0;
+			duration = 0;
+			/* IPv6 cltt is told before ia addresses */
+			if (state->ip_version == IPv4)
+				cltt = 0;
 			break;
 		case PREFIX_BINDING_STATE_FREE:
 		case PREFIX_BINDING_STATE_ABANDONED:
 		case PREFIX_BINDING_STATE_EXPIRED:
 		case PREFIX_BINDING_STATE_RELEASED:
-			if ((lease = find_lease(state, &addr)) != NULL)
-				delete_lease(state, lease);
-			add_lease(state, &addr, FREE);
+			current = bind_lease(state, &addr, FREE, duration, cltt, cltt ? cltt : starts);
 			break;
 		case PREFIX_BINDING_STATE_ACTIVE:
-			/* remove old entry, if exists */
-			if ((lease = find_lease(state, &addr)) != NULL)
-				delete_lease(state, lease);
-			add_lease(state, &addr, ACTIVE);
+			current = bind_lease(state, &addr, ACTIVE, duration, cltt, cltt ? cltt : starts);
 			break;
 		case PREFIX_BINDING_STATE_BACKUP:
-			/* remove old entry, if exists */
-			if ((lease = find_lease(state, &addr)) != NULL)
-				delete_lease(state, lease);
-			add_lease(state, &addr, BACKUP);
+			current = bind_lease(state, &addr, BACKUP, duration, cltt, cltt ? cltt : starts);
 			state->backups_found = 1;
 			break;
+		case PREFIX_STARTS:
+			starts = parse_lease_time(line + 9);
+			duration = lease_duration(starts, ends);
+			if (current)
+				current->duration = duration;
+			break;
+		case PREFIX_ENDS:
+			ends = parse_lease_time(line + 7);
+			duration = lease_duration(starts, ends);
+			if (current)
+				current->duration = duration;
+			break;
+		case PREFIX_MAX_LIFE:
+			/* IPv6 leases tell valid lifetime directly */
+			duration = strtoul(line + 13, NULL, 10);
+			if (current)
+				current->duration = duration;
+			break;
+		case PREFIX_CLTT:
+			cltt = parse_lease_time(line + 7);
+			if (state->ip_version == IPv6)
+				/* a new ia begins, previous address is done */
+				current = NULL;
+			else if (current)
+				current->cltt = cltt;
+			break;
 		case PREFIX_HARDWARE_ETHERNET:
 			if (print_mac_addreses == 0)
 				break;
 			memcpy(macstring, line + 20, 17);
 			macstring[17] = '\0';
-			if ((lease = find_lease(state, &addr)) != NULL)
+			if ((lease = find_lease(state, &addr)) != NULL) {
 				lease->ethernet = xstrdup(macstring);
+				if (state->duplicates && lease->type == ACTIVE && lease->mac == NULL)
+					add_mac(state, lease);
+			}
 			break;
 		default:
 			/* do nothing */ ;
@@ -158,10 +284,137 @@ int parse_leases(struct conf_t *state, const int print_mac_addreses)
 #undef HAS_PREFIX
 	free(line);
 	free(ipstring);
-	fclose(dhcpd_leases);
+	return lease_file_close(state, dhcpd_leases);
+}
+
+/*! \brief Read a lease file.  When dhcpd rewrites the file, and renames
+ * the new one in place during the read, the leases are thrown away and
+ * the new file is read.  Bytes read in vain are counted as skipped.
+ * Replay cannot take back output it already printed, and does not
+ * restart.  When the file keeps changing the last read, which is a
+ * consistent copy of a file that did exist, is used. */
+int parse_leases(struct conf_t *state, const int print_mac_addreses)
+{
+	struct parse_stats_t saved;
+	uint64_t skipped;
+	int i;
+
+	for (i = 0;; i++) {
+		saved = state->stats;
+		if (!parse_lease_file(state, print_mac_addreses) || state->replay_interval
+		    || i == LEASE_FILE_RETRIES)
+			break;
+		skipped = state->stats.lease_bytes - saved.lease_bytes;
+		state->stats = saved;
+		state->stats.lease_skipped += skipped;
+		state->stats.lease_restarts++;
+		delete_all_leases(state);
+		spill_free(state);
+	}
 	return 0;
 }
 
+/*! \struct lease_file_job
+ * \brief Parsing state of one lease file when multiple files are merged.
+ */
+struct lease_file_job {
+	struct conf_t state;		/*!< Copy of run time state with a lease hash of its own. */
+	int print_mac_addreses;		/*!< Same as parse_leases() argument. */
+};
+
+/*! \brief Parse one of the lease files to be merged.
+ * \param arg Pointer to lease_file_job.
+ * \return Always NULL, failures are fatal. */
+static void *parse_lease_file_job(void *arg)
+{
+	struct lease_file_job *job = arg;
+
+	/* function pointers are thread local */
+	set_ipv_functions(&job->state, job->state.ip_version);
+	parse_leases(&job->state, job->print_mac_addreses);
+	return NULL;
+}
+
+/*! \brief Read all lease files, and merge them to a single lease hash.
+ * Typical use is to combine dhcpd failover peer lease files.  Each file is
+ * parsed to a hash of its own, in parallel when threads are available,
+ * and then merged by using state->merge_rule.
+ * \param print_mac_addreses Same as parse_leases() argument. */
+void parse_lease_files(struct conf_t *state, const int print_mac_addreses)
+{
+	struct lease_file_job *jobs;
+	struct leases_t *l;
+	unsigned int i, first = 0;
+#ifdef USE_THREADS
+	pthread_t *threads;
+	int ret;
+#endif
+
+	/* lease filter searches ranges by address */
+	if (state->only_net || state->only_shared)
+		sort_ranges(state);
+	if (state->num_lease_files < 2) {
+		parse_leases(state, print_mac_addreses);
+		return;
+	}
+	jobs = xcalloc(state->num_lease_files, sizeof(struct lease_file_job));
+	for (i = 0; i < state->num_lease_files; i++) {
+		jobs[i].state = *state;
+		jobs[i].state.leases = NULL;
+		jobs[i].state.macs = NULL;
+		/* hardware address index is built after merge */
+		jobs[i].state.duplicates = 0;
+		jobs[i].state.dhcpdlease_file = state->lease_files[i];
+		jobs[i].print_mac_addreses = print_mac_addreses;
+	}
+	/* When configuration did not tell ip version the first lease line
+	 * will, and that changes global function pointers.  Parse files
+	 * one by one until version is known to avoid racing with that. */
+	while (state->ip_version == IPvUNKNOWN && first < state->num_lease_files) {
+		parse_lease_file_job(&jobs[first]);
+		state->ip_version = jobs[first].state.ip_version;
+		first++;
+	}
+	for (i = first; i < state->num_lease_files; i++)
+		jobs[i].state.ip_version = state->ip_version;
+#ifdef USE_THREADS
+	threads = xcalloc(state->num_lease_files, sizeof(pthread_t));
+	for (i = first; i < state->num_lease_files; i++) {
+		ret = pthread_create(&threads[i], NULL, parse_lease_file_job, &jobs[i]);
+		if (ret)
+			error(EXIT_FAILURE, ret, "parse_lease_files: pthread_create");
+	}
+	for (i = first; i < state->num_lease_files; i++) {
+		ret = pthread_join(threads[i], NULL);
+		if (ret)
+			error(EXIT_FAILURE, ret, "parse_lease_files: pthread_join");
+	}
+	free(threads);
+#else
+	for (i = first; i < state->num_lease_files; i++)
+		parse_lease_file_job(&jobs[i]);
+#endif
+	/* Merge in command line order, so that ties favor earlier files. */
+	for (i = 0; i < state->num_lease_files; i++) {
+		merge_leases(state, &jobs[i].state.leases);
+		state->stats.lease_bytes += jobs[i].state.stats.lease_bytes;
+		state->stats.lease_lines += jobs[i].state.stats.lease_lines;
+		state->stats.lease_records += jobs[i].state.stats.lease_records;
+		state->stats.repeated += jobs[i].state.stats.repeated;
+		state->stats.lease_skipped += jobs[i].state.stats.lease_skipped;
+		state->stats.lease_restarts += jobs[i].state.stats.lease_restarts;
+	}
+	free(jobs);
+	/* Backup state is what the merge decided, not what any file said. */
+	state->backups_found = 0;
+	for (l = state->leases; l; l = l->hh.next) {
+		if (l->type == BACKUP)
+			state->backups_found = 1;
+		else if (state->duplicates && l->type == ACTIVE)
+			add_mac(state, l);
+	}
+}
+
 /*! \brief Keyword search in dhcpd.conf file.
  * \param s A line from the dhcpd.conf file.
  * \return Indicator what configuration was found. */
@@ -169,6 +422,9 @@ static int is_interesting_config_clause(struct conf_t *state, char const *restri
 {
 	if (strstr(s, "range"))
 		return ITS_A_RANGE_FIRST_IP;
+	/* not fixed-prefix6 of a host */
+	if (!strcmp(s, "prefix6"))
+		return ITS_A_PREFIX_FIRST_IP;
 	if (strstr(s, "shared-network"))
 		return ITS_A_SHAREDNET;
 	if (state->all_as_shared) {
@@ -179,9 +435,80 @@ static int is_interesting_config_clause(struct conf_t *state, char const *restri
 	}
 	if (strstr(s, "include"))
 		return ITS_AN_INCLUDE;
+	if (state->pool_counting) {
+		if (strstr(s, "pool"))
+			return ITS_A_POOL;
+		if (strstr(s, "allow"))
+			return ITS_AN_ALLOW;
+		if (strstr(s, "deny"))
+			return ITS_A_DENY;
+	}
 	return ITS_NOTHING_INTERESTING;
 }
 
+/*! \brief Add a pool{} block to the end of pools list.  Pools are named
+ * by their shared network and order of appearance.
+ * \return Pointer to the new pool. */
+static struct shared_network_t *new_pool(struct conf_t *state,
+					 const struct shared_network_t *shared_p)
+{
+	struct shared_network_t *pool_p, **p;
+	size_t len;
+
+	pool_p = xcalloc(sizeof(struct shared_network_t), 1);
+	state->num_pools++;
+	len = strlen(shared_p->name) + sizeof(" pool 4294967295");
+	pool_p->name = xmalloc(len);
+	snprintf(pool_p->name, len, "%s pool %u", shared_p->name, state->num_pools);
+	/* forecasts are not made for pools */
+	pool_p->eta = NAN;
+	for (p = &state->pools; *p; p = &(*p)->next)
+		/* find the end */ ;
+	*p = pool_p;
+	return pool_p;
+}
+
+/*! \brief Record an allow or deny statement of a pool as class membership.
+ * Class name is the statement argument without 'members of' words, and
+ * denied classes have exclamation mark prefix.
+ * \param member Words after allow or deny keyword. */
+static void add_pool_class(struct conf_t *state, struct shared_network_t *pool_p,
+			   char *member, const int deny)
+{
+	struct shared_network_t *class_p, **p;
+	char *name;
+	size_t len;
+	unsigned int i;
+
+	len = strlen(member);
+	while (0 < len && isspace(member[len - 1]))
+		member[--len] = '\0';
+	if (!strncmp(member, "members of ", 11))
+		member += 11;
+	if (*member == '\0')
+		return;
+	len = strlen(member) + 2;
+	name = xmalloc(len);
+	snprintf(name, len, "%s%s", deny ? "!" : "", member);
+	for (p = &state->classes; *p; p = &(*p)->next)
+		if (!strcmp((*p)->name, name))
+			break;
+	if (*p == NULL) {
+		*p = xcalloc(sizeof(struct shared_network_t), 1);
+		(*p)->name = name;
+		(*p)->eta = NAN;
+	} else
+		free(name);
+	class_p = *p;
+	for (i = 0; i < pool_p->num_classes; i++)
+		if (pool_p->classes[i] == class_p)
+			return;
+	pool_p->classes = xrealloc(pool_p->classes,
+				   sizeof(struct shared_network_t *) * (pool_p->num_classes + 1));
+	pool_p->classes[pool_p->num_classes] = class_p;
+	pool_p->num_classes++;
+}
+
 /*! \brief Flip first and last IP in range if they are in unusual order.
  */
 static void reorder_last_first(struct range_t *range_p)
@@ -195,6 +522,78 @@ static void reorder_last_first(struct range_t *range_p)
 	}
 }
 
+/*! \brief Check a range against --only-net and --only-shared filters.
+ * \return Non-zero when the range is kept. */
+static int range_selected(struct conf_t *state, const struct range_t *range_p,
+			  const struct shared_network_t *shared_p)
+{
+	if (state->only_shared && strcmp(shared_p->name, state->only_shared))
+		return 0;
+	if (state->only_net && (ipcomp(&range_p->last_ip, &state->only_first) < 0
+				|| ipcomp(&state->only_last, &range_p->first_ip) < 0))
+		return 0;
+	return 1;
+}
+
+/*! \brief Compare pointers, used to search sets of shared networks. */
+static int ptrcomp(const void *a, const void *b)
+{
+	const void *x = *(void *const *)a, *y = *(void *const *)b;
+
+	return (x > y) - (x < y);
+}
+
+/*! \brief Remove shared networks, pools, or classes that are not in a set.
+ * \param p Pointer to the list head.
+ * \param set Sorted array of entries to keep.
+ * \return The last entry of the list, or NULL when the list is empty. */
+static struct shared_network_t *prune_shnet_list(struct shared_network_t **p,
+						 struct shared_network_t **set, size_t num)
+{
+	struct shared_network_t *c, *last = NULL;
+
+	qsort(set, num, sizeof(*set), ptrcomp);
+	while ((c = *p) != NULL) {
+		if (bsearch(&c, set, num, sizeof(*set), ptrcomp)) {
+			last = c;
+			p = &c->next;
+			continue;
+		}
+		*p = c->next;
+		free(c->name);
+		free(c->classes);
+		free(c);
+	}
+	return last;
+}
+
+/*! \brief Remove shared networks, pools, and classes that have no ranges
+ * left after filtering, so that output and counting do not need to walk
+ * over them. */
+static void prune_config(struct conf_t *state)
+{
+	struct shared_network_t **set, *c;
+	size_t num = 0, size = state->num_ranges + 1;
+	unsigned int i, j;
+
+	for (c = state->pools; c; c = c->next)
+		size += c->num_classes;
+	set = xmalloc(sizeof(*set) * size);
+	for (i = 0; i < state->num_ranges; i++)
+		set[num++] = state->ranges[i].shared_net;
+	c = prune_shnet_list(&state->shared_net_root->next, set, num);
+	state->shared_net_head = c ? c : state->shared_net_root;
+	for (num = 0, i = 0; i < state->num_ranges; i++)
+		if (state->ranges[i].pool)
+			set[num++] = state->ranges[i].pool;
+	prune_shnet_list(&state->pools, set, num);
+	for (num = 0, c = state->pools; c; c = c->next)
+		for (j = 0; j < c->num_classes; j++)
+			set[num++] = c->classes[j];
+	prune_shnet_list(&state->classes, set, num);
+	free(set);
+}
+
 /*! \brief The dhcpd.conf file parser.
  * FIXME: This spaghetti monster function needs to be rewrote at least
  * ones more.
@@ -207,11 +606,15 @@ void parse_config(struct conf_t *state, const int is_include, const char *restri
 	int quote = 0, braces = 0, argument = ITS_NOTHING_INTERESTING;
 	size_t i = 0;
 	char *word;
-	int braces_shared = 1000;
+	int braces_shared = 1000, braces_pool = 1000;
 	union ipaddr_t addr;
 	struct range_t *range_p = NULL;
+	struct shared_network_t *pool_p = NULL;
+	char *member, *prefix_len;
 
 	word = xmalloc(sizeof(char) * MAXLEN);
+	member = xmalloc(sizeof(char) * MAXLEN);
+	member[0] = '\0';
 	if (is_include)
 		/* Default place holder for ranges "All networks". */
 		shared_p->name = state->shared_net_root->name;
@@ -219,6 +622,17 @@ void parse_config(struct conf_t *state, const int is_include, const char *restri
 	dhcpd_config = fopen(config_file, "r");
 	if (dhcpd_config == NULL)
 		error(EXIT_FAILURE, errno, "parse_config: %s", config_file);
+	/* long running modes notice changes of included files */
+	if (!is_include) {
+		struct stat st;
+
+		if (fstat(fileno(dhcpd_config), &st))
+			error(EXIT_FAILURE, errno, "parse_config: %s", config_file);
+		file_stamp_add(&state->include_stamp, &st);
+		state->include_files = xrealloc(state->include_files, sizeof(char *) *
+						(state->num_include_files + 1));
+		state->include_files[state->num_include_files++] = xstrdup(config_file);
+	}
 #ifdef HAVE_POSIX_FADVISE
 # ifdef POSIX_FADV_SEQUENTIAL
 	if (posix_fadvise(fileno(dhcpd_config), 0, 0, POSIX_FADV_SEQUENTIAL) != 0)
@@ -254,11 +668,32 @@ void parse_config(struct conf_t *state, const int is_include, const char *restri
 			/* Quoted colon does not mean new clause */
 			if (0 < quote)
 				break;
+			if (comment == 0 && (argument == ITS_AN_ALLOW || argument == ITS_A_DENY)) {
+				/* last word of allow or deny ends to ; */
+				word[i] = '\0';
+				if (strlen(member) + i < MAXLEN - 1)
+					strcat(member, word);
+				add_pool_class(state, pool_p, member, argument == ITS_A_DENY);
+				member[0] = '\0';
+				argument = ITS_NOTHING_INTERESTING;
+				newclause = 1;
+				i = 0;
+				continue;
+			}
 			if (comment == 0
 			    && argument != ITS_A_RANGE_FIRST_IP
-			    && argument != ITS_A_RANGE_SECOND_IP && argument != ITS_AN_INCLUDE) {
+			    && argument != ITS_A_RANGE_SECOND_IP && argument != ITS_AN_INCLUDE
+			    && argument != ITS_A_PREFIX_SECOND_IP && argument != ITS_A_PREFIX_LENGTH) {
 				newclause = 1;
 				i = 0;
+			} else if (argument == ITS_A_PREFIX_SECOND_IP || argument == ITS_A_PREFIX_LENGTH) {
+				if (0 < i) {
+					/* prefix6 ends to the length */
+					c = ' ';
+					break;
+				}
+				argument = ITS_NOTHING_INTERESTING;
+				newclause = 1;
 			} else if (argument == ITS_A_RANGE_FIRST_IP && one_ip_range == 1) {
 				argument = ITS_A_RANGE_SECOND_IP;
 				c = ' ';
@@ -306,6 +741,11 @@ void parse_config(struct conf_t *state, const int is_include, const char *restri
 					braces_shared = 1000;
 					shared_p = state->shared_net_root;
 				}
+				/* End of pool */
+				if (braces_pool == braces) {
+					braces_pool = 1000;
+					pool_p = NULL;
+				}
 				/* Not literally 1, but works for this
 				 * program */
 				newclause = 1;
@@ -345,6 +785,15 @@ void parse_config(struct conf_t *state, const int is_include, const char *restri
 			argument = is_interesting_config_clause(state, word);
 			if (argument == ITS_A_RANGE_FIRST_IP)
 				one_ip_range = 1;
+			else if (argument == ITS_A_POOL) {
+				pool_p = new_pool(state, shared_p);
+				/* the brace is already counted in 'pool{' */
+				braces_pool = braces - (word[strlen(word) - 1] == '{');
+				argument = ITS_NOTHING_INTERESTING;
+			} else if ((argument == ITS_AN_ALLOW || argument == ITS_A_DENY)
+				   && pool_p == NULL)
+				/* global allow and deny are not about pools */
+				argument = ITS_NOTHING_INTERESTING;
 		}
 		/* words after range, shared-network or include */
 		else if (argument != ITS_NOTHING_INTERESTING) {
@@ -356,6 +805,7 @@ void parse_config(struct conf_t *state, const int is_include, const char *restri
 			case ITS_A_RANGE_SECOND_IP:
 				/* printf ("range 2nd ip: %s\n", word); */
 				range_p = state->ranges + state->num_ranges;
+				range_p->prefix_len = 0;
 				argument = ITS_NOTHING_INTERESTING;
 				if (strchr(word, '/')) {
 					parse_cidr(state, range_p, word);
@@ -371,10 +821,20 @@ void parse_config(struct conf_t *state, const int is_include, const char *restri
 					reorder_last_first(range_p);
 				}
  newrange:
+				if (!range_selected(state, range_p, shared_p)) {
+					newclause = 1;
+					break;
+				}
 				range_p->count = 0;
 				range_p->touched = 0;
 				range_p->backups = 0;
+				range_p->growth_rate = 0;
+				range_p->eta = 0;
+				memset(range_p->lease_hist, 0, sizeof(range_p->lease_hist));
+				range_p->bitmap = NULL;
+				range_p->unchanged = 0;
 				range_p->shared_net = shared_p;
+				range_p->pool = pool_p;
 				state->num_ranges++;
 				if (state->ranges_size <= state->num_ranges) {
 					state->ranges_size *= 2;
@@ -386,6 +846,7 @@ void parse_config(struct conf_t *state, const int is_include, const char *restri
 			case ITS_A_RANGE_FIRST_IP:
 				/* printf ("range 1nd ip: %s\n", word); */
 				range_p = state->ranges + state->num_ranges;
+				range_p->prefix_len = 0;
 				if (!(parse_ipaddr(state, word, &addr)))
 					/* word was not ip, try again */
 					break;
@@ -393,6 +854,37 @@ void parse_config(struct conf_t *state, const int is_include, const char *restri
 				one_ip_range = 0;
 				argument = ITS_A_RANGE_SECOND_IP;
 				break;
+			case ITS_A_PREFIX_FIRST_IP:
+				/* prefix6 low high /length; */
+				range_p = state->ranges + state->num_ranges;
+				if (!(parse_ipaddr(state, word, &addr))) {
+					argument = ITS_NOTHING_INTERESTING;
+					break;
+				}
+				copy_ipaddr(&range_p->first_ip, &addr);
+				argument = ITS_A_PREFIX_SECOND_IP;
+				break;
+			case ITS_A_PREFIX_SECOND_IP:
+				/* length can be written together with the address */
+				prefix_len = strchr(word, '/');
+				if (prefix_len)
+					*prefix_len = '\0';
+				if (!(parse_ipaddr(state, word, &addr))) {
+					argument = ITS_NOTHING_INTERESTING;
+					break;
+				}
+				copy_ipaddr(&range_p->last_ip, &addr);
+				reorder_last_first(range_p);
+				argument = ITS_A_PREFIX_LENGTH;
+				if (prefix_len == NULL)
+					break;
+				argument = ITS_NOTHING_INTERESTING;
+				parse_prefix_len(range_p, prefix_len + 1);
+				goto newrange;
+			case ITS_A_PREFIX_LENGTH:
+				argument = ITS_NOTHING_INTERESTING;
+				parse_prefix_len(range_p, word);
+				goto newrange;
 			case ITS_A_SHAREDNET:
 			case ITS_A_SUBNET:
 				/* ignore subnets inside a shared-network */
@@ -435,6 +927,15 @@ void parse_config(struct conf_t *state, const int is_include, const char *restri
 				parse_config(state, 0, word, shared_p);
 				newclause = 1;
 				break;
+			case ITS_AN_ALLOW:
+			case ITS_A_DENY:
+				/* collect words until ; */
+				if (strlen(member) + strlen(word) + 1 < MAXLEN) {
+					strcat(member, word);
+					strcat(member, " ");
+				}
+				break;
+			case ITS_A_POOL:
 			case ITS_NOTHING_INTERESTING:
 				/* printf ("nothing interesting: %s\n", word); */
 				argument = ITS_NOTHING_INTERESTING;
@@ -446,6 +947,11 @@ void parse_config(struct conf_t *state, const int is_include, const char *restri
 		}
 	}
 	free(word);
+	free(member);
+	state->stats.conf_bytes += ftello(dhcpd_config);
 	fclose(dhcpd_config);
+	/* filtering is done when the main configuration file ends */
+	if (is_include && (state->only_net || state->only_shared))
+		prune_config(state);
 	return;
 }
@@ -40,7 +40,9 @@
 
 #include <config.h>
 
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "xalloc.h"
 
@@ -51,13 +53,15 @@
 
 /*! \brief Add a lease to hash array.
  * \param addr Binary IP to be added in leases hash.
- * \param type Lease state of the IP. */
-void add_lease_init(struct conf_t *state __attribute__ ((unused)), union ipaddr_t *addr
-		    __attribute__ ((unused)), enum ltype type __attribute__ ((unused)))
+ * \param type Lease state of the IP.
+ * \return Pointer to the lease that was added. */
+struct leases_t *add_lease_init(struct conf_t *state __attribute__ ((unused)), union ipaddr_t *addr
+				__attribute__ ((unused)), enum ltype type __attribute__ ((unused)))
 {
+	return NULL;
 }
 
-void add_lease_v4(struct conf_t *state, union ipaddr_t *addr, enum ltype type)
+struct leases_t *add_lease_v4(struct conf_t *state, union ipaddr_t *addr, enum ltype type)
 {
 	struct leases_t *l;
 
@@ -66,9 +70,14 @@ void add_lease_v4(struct conf_t *state, union ipaddr_t *addr, enum ltype type)
 	l->type = type;
 	HASH_ADD_INT(state->leases, ip.v4, l);
 	l->ethernet = NULL;
+	l->duration = 0;
+	l->cltt = 0;
+	l->mac = NULL;
+	l->mac_next = NULL;
+	return l;
 }
 
-void add_lease_v6(struct conf_t *state, union ipaddr_t *addr, enum ltype type)
+struct leases_t *add_lease_v6(struct conf_t *state, union ipaddr_t *addr, enum ltype type)
 {
 	struct leases_t *l;
 
@@ -77,6 +86,11 @@ void add_lease_v6(struct conf_t *state, union ipaddr_t *addr, enum ltype type)
 	l->type = type;
 	HASH_ADD_V6(state->leases, ip.v6, l);
 	l->ethernet = NULL;
+	l->duration = 0;
+	l->cltt = 0;
+	l->mac = NULL;
+	l->mac_next = NULL;
+	return l;
 }
 
 /*! \brief Find pointer to lease from hash array.
@@ -105,10 +119,32 @@ struct leases_t *find_lease_v6(struct conf_t *state, union ipaddr_t *addr)
 	return l;
 }
 
+/*! \brief Remove a lease from hardware address index.  The index entry
+ * is deleted when it has no leases left.
+ * \param lease A lease that is in the index. */
+static void delete_mac(struct conf_t *state, struct leases_t *lease)
+{
+	struct macs_t *m = lease->mac;
+	struct leases_t **p;
+
+	for (p = &m->leases; *p != lease; p = &(*p)->mac_next)
+		/* find the link */ ;
+	*p = lease->mac_next;
+	lease->mac = NULL;
+	lease->mac_next = NULL;
+	m->count--;
+	if (m->count == 0) {
+		HASH_DEL(state->macs, m);
+		free(m);
+	}
+}
+
 /*! \brief Delete a lease from hash array.
  * \param lease Pointer to lease hash. */
 void delete_lease(struct conf_t *state, struct leases_t *lease)
 {
+	if (lease->mac)
+		delete_mac(state, lease);
 	free(lease->ethernet);
 	HASH_DEL(state->leases, lease);
 	free(lease);
@@ -120,6 +156,12 @@ void delete_all_leases(struct conf_t *state)
 {
 	struct leases_t *l, *tmp;
 
+	struct macs_t *m, *mtmp;
+
+	HASH_ITER(hh, state->macs, m, mtmp) {
+		HASH_DEL(state->macs, m);
+		free(m);
+	}
 	HASH_ITER(hh, state->leases, l, tmp) {
 		free(l->ethernet);
 		HASH_DEL(state->leases, l);
@@ -129,6 +171,13 @@ void delete_all_leases(struct conf_t *state)
 #else
 void delete_all_leases(struct conf_t *state)
 {
+	while (state->macs) {
+		struct macs_t *m;
+
+		m = state->macs;
+		HASH_DEL(state->macs, m);
+		free(m);
+	}
 	while (state->leases) {
 		struct leases_t *l;
 
@@ -139,3 +188,87 @@ void delete_all_leases(struct conf_t *state)
 	}
 }
 #endif
+
+/*! \brief Insert an already allocated lease to hash array. */
+static void insert_lease(struct conf_t *state, struct leases_t *l)
+{
+	if (state->ip_version == IPv6)
+		HASH_ADD_V6(state->leases, ip.v6, l);
+	else
+		HASH_ADD_INT(state->leases, ip.v4, l);
+}
+
+/*! \brief Decide if a lease from an other lease file replaces the one
+ * that is already known.
+ * \param new Lease from the file being merged.
+ * \param old Lease already in state->leases.
+ * \return True when new lease should be used. */
+static int lease_wins(struct conf_t *state, const struct leases_t *new,
+		      const struct leases_t *old)
+{
+	if (state->merge_rule == MERGE_STATE && (new->type == ACTIVE) != (old->type == ACTIVE))
+		return new->type == ACTIVE;
+	if (new->cltt != old->cltt)
+		return old->cltt < new->cltt;
+	/* Peers agree about time, prefer the one that has the lease in use. */
+	return new->type == ACTIVE && old->type != ACTIVE;
+}
+
+/*! \brief Move leases from an other hash array to state->leases.  When
+ * both have the same address state->merge_rule decides which one is kept.
+ * \param from Lease hash to be merged, it is empty on return. */
+void merge_leases(struct conf_t *state, struct leases_t **from)
+{
+	while (*from) {
+		struct leases_t *l, *old;
+
+		l = *from;
+		HASH_DEL(*from, l);
+		old = find_lease(state, &l->ip);
+		if (old == NULL)
+			insert_lease(state, l);
+		else if (lease_wins(state, l, old)) {
+			delete_lease(state, old);
+			insert_lease(state, l);
+		} else {
+			free(l->ethernet);
+			free(l);
+		}
+	}
+}
+
+/*! \brief Add an active lease to hardware address index.  The lease
+ * ethernet string is converted to binary key, and leases without a valid
+ * ethernet address are ignored.
+ * \param lease A lease that is not in the index yet. */
+void add_mac(struct conf_t *state, struct leases_t *lease)
+{
+	uint8_t mac[MAC_LEN];
+	struct macs_t *m;
+
+	if (lease->ethernet == NULL
+	    || sscanf(lease->ethernet, "%2hhx:%2hhx:%2hhx:%2hhx:%2hhx:%2hhx",
+		      &mac[0], &mac[1], &mac[2], &mac[3], &mac[4], &mac[5]) != MAC_LEN)
+		return;
+	HASH_FIND(hh, state->macs, mac, MAC_LEN, m);
+	if (m == NULL) {
+		m = xcalloc(sizeof(struct macs_t), 1);
+		memcpy(m->mac, mac, MAC_LEN);
+		HASH_ADD(hh, state->macs, mac, MAC_LEN, m);
+	}
+	lease->mac = m;
+	lease->mac_next = m->leases;
+	m->leases = lease;
+	m->count++;
+}
+
+/*! \brief Convert binary hardware address to a printable string.
+ * \return Pointer to a static buffer. */
+const char *ntop_mac(const uint8_t *mac)
+{
+	static THREAD_LOCAL char buf[sizeof("00:00:00:00:00:00")];
+
+	snprintf(buf, sizeof(buf), "%02x:%02x:%02x:%02x:%02x:%02x",
+		 mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+	return buf;
+}
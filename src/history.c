@@ -0,0 +1,569 @@
+/*
+ * The dhcpd-pools has BSD 2-clause license which also known as "Simplified
+ * BSD License" or "FreeBSD License".
+ *
+ * Copyright 2006- Sami Kerola. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the
+ *       distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR AND CONTRIBUTORS OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing
+ * official policies, either expressed or implied, of Sami Kerola.
+ */
+
+
+/*! \file history.c
+ * \brief Per range and shared network usage history ring file.
+ *
+ * The history file is a memory mapped ring of fixed size records.  The
+ * file begins with a header and a ring of sample time stamps, followed by
+ * one block per range or shared network.  A block starts with a series
+ * descriptor and is followed by one record for every ring slot, so reading
+ * the last N hours of a series is a binary search over the time stamps and
+ * a contiguous read of records.  New ranges and shared networks are
+ * appended as new blocks at the end of the file, all new blocks of a run
+ * with one file extension.
+ */
+
+#include <config.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "close-stream.h"
+#include "error.h"
+#include "xalloc.h"
+
+#include "dhcpd-pools.h"
+
+/*! \def HISTORY_MAGIC
+ * \brief History file identifier, including format version.
+ */
+#define HISTORY_MAGIC "DPHIST01"
+
+/*! \enum history_series_type
+ * \brief What a history series is about.
+ */
+enum history_series_type {
+	HIST_RANGE,
+	HIST_SHNET,
+	HIST_ALL
+};
+
+/*! \struct history_header
+ * \brief The history file header.
+ */
+struct history_header {
+	char magic[8];
+	uint32_t ip_version;		/*!< The dhcp_version of the data. */
+	uint32_t capacity;		/*!< Number of slots in the ring. */
+	uint32_t head;			/*!< Next slot to be written. */
+	uint32_t count;			/*!< Number of slots in use. */
+	uint32_t num_series;		/*!< Number of series blocks. */
+	uint32_t pad;
+};
+
+/*! \struct history_series
+ * \brief Descriptor in the beginning of a series block.
+ */
+struct history_series {
+	uint32_t type;			/*!< The history_series_type. */
+	uint32_t has_backups;		/*!< A sample of the series had backups. */
+	union ipaddr_t first_ip;
+	union ipaddr_t last_ip;
+	char name[64];			/*!< Shared network name. */
+};
+
+/*! \struct history_record
+ * \brief One sample of a series.  The defined is NAN when the series did
+ * not exist at the time of the sample.
+ */
+struct history_record {
+	double defined;
+	uint32_t used;
+	uint32_t touched;
+	uint32_t backups;
+	uint32_t pad;
+};
+
+/*! \struct history_index
+ * \brief Hash entry from a series descriptor to its block number.
+ */
+struct history_index {
+	struct history_series key;	/*!< Descriptor with has_backups cleared. */
+	uint32_t block;
+	UT_hash_handle hh;
+};
+
+/*! \struct history_map
+ * \brief A memory mapped history file.
+ */
+struct history_map {
+	int fd;
+	size_t size;
+	struct history_header *hdr;
+	struct history_index *index;	/*!< Hash of series descriptors. */
+	struct history_index *blocks;	/*!< Hash entries of existing blocks. */
+};
+
+/*! \brief Size of a series block. */
+static size_t block_size(uint32_t capacity)
+{
+	return sizeof(struct history_series) + capacity * sizeof(struct history_record);
+}
+
+/*! \brief Ring time stamps right after the header. */
+static int64_t *ring_times(struct history_map *map)
+{
+	return (int64_t *)(map->hdr + 1);
+}
+
+/*! \brief Pointer to series descriptor by index. */
+static struct history_series *series_at(struct history_map *map, uint32_t i)
+{
+	char *p = (char *)(ring_times(map) + map->hdr->capacity);
+
+	return (struct history_series *)(p + i * block_size(map->hdr->capacity));
+}
+
+/*! \brief Records of a series. */
+static struct history_record *series_records(struct history_series *s)
+{
+	return (struct history_record *)(s + 1);
+}
+
+/*! \brief File size needed for a number of series. */
+static size_t map_size(uint32_t capacity, uint32_t num_series)
+{
+	return sizeof(struct history_header) + capacity * sizeof(int64_t) +
+	    num_series * block_size(capacity);
+}
+
+/*! \brief Map history file to memory, and remap if size has changed. */
+static void history_mmap(struct history_map *map, size_t size)
+{
+	if (map->hdr)
+		munmap(map->hdr, map->size);
+	map->size = size;
+	map->hdr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, map->fd, 0);
+	if (map->hdr == MAP_FAILED)
+		error(EXIT_FAILURE, errno, "history_mmap: mmap");
+}
+
+/*! \brief Open, lock, and map a history file.  A missing file is created
+ * when create is set.
+ * \return Zero on success, or -1 when file does not exist.  */
+static int history_open(struct conf_t *state, struct history_map *map, int create)
+{
+	struct stat st;
+
+	map->hdr = NULL;
+	map->index = map->blocks = NULL;
+	map->fd = open(state->history_file, create ? O_RDWR | O_CREAT : O_RDONLY, 0644);
+	if (map->fd < 0) {
+		if (!create && errno == ENOENT)
+			return -1;
+		error(EXIT_FAILURE, errno, "history_open: %s", state->history_file);
+	}
+	if (flock(map->fd, create ? LOCK_EX : LOCK_SH))
+		error(EXIT_FAILURE, errno, "history_open: flock %s", state->history_file);
+	if (fstat(map->fd, &st))
+		error(EXIT_FAILURE, errno, "history_open: fstat %s", state->history_file);
+	if (st.st_size == 0 && create) {
+		struct history_header hdr = {
+			.magic = HISTORY_MAGIC,
+			.ip_version = state->ip_version,
+			.capacity = state->history_retention
+		};
+		size_t size = map_size(hdr.capacity, 0);
+
+		if (ftruncate(map->fd, size))
+			error(EXIT_FAILURE, errno, "history_open: ftruncate %s", state->history_file);
+		history_mmap(map, size);
+		*map->hdr = hdr;
+		return 0;
+	}
+	if ((size_t)st.st_size < sizeof(struct history_header))
+		error(EXIT_FAILURE, 0, "history_open: %s: file is truncated", state->history_file);
+	map->size = st.st_size;
+	map->hdr = mmap(NULL, map->size, create ? PROT_READ | PROT_WRITE : PROT_READ,
+			MAP_SHARED, map->fd, 0);
+	if (map->hdr == MAP_FAILED)
+		error(EXIT_FAILURE, errno, "history_open: mmap %s", state->history_file);
+	if (memcmp(map->hdr->magic, HISTORY_MAGIC, sizeof(map->hdr->magic)))
+		error(EXIT_FAILURE, 0, "history_open: %s: not a history file", state->history_file);
+	if (map->size < map_size(map->hdr->capacity, map->hdr->num_series))
+		error(EXIT_FAILURE, 0, "history_open: %s: file is truncated", state->history_file);
+	return 0;
+}
+
+/*! \brief Unmap and unlock history file. */
+static void history_close(struct history_map *map)
+{
+	HASH_CLEAR(hh, map->index);
+	free(map->blocks);
+	if (map->hdr)
+		munmap(map->hdr, map->size);
+	close(map->fd);
+}
+
+/*! \brief Hash the series descriptors of the file by their keys. */
+static void history_index_build(struct history_map *map)
+{
+	struct history_index *e;
+	uint32_t i, n = map->hdr->num_series;
+
+	map->blocks = xcalloc(n ? n : 1, sizeof(struct history_index));
+	for (i = 0, e = map->blocks; i < n; i++, e++) {
+		e->key = *series_at(map, i);
+		e->key.has_backups = 0;
+		e->block = i;
+		HASH_ADD(hh, map->index, key, sizeof(struct history_series), e);
+	}
+}
+
+/*! \brief Set history series key of a range. */
+static void range_key(struct history_series *key, const struct range_t *range_p)
+{
+	memset(key, 0, sizeof(*key));
+	key->type = HIST_RANGE;
+	copy_ipaddr(&key->first_ip, &range_p->first_ip);
+	copy_ipaddr(&key->last_ip, &range_p->last_ip);
+	snprintf(key->name, sizeof(key->name), "%s", range_p->shared_net->name);
+}
+
+/*! \brief Set history series key of a shared network. */
+static void shnet_key(struct conf_t *state, struct history_series *key,
+		      const struct shared_network_t *shared_p)
+{
+	memset(key, 0, sizeof(*key));
+	key->type = shared_p == state->shared_net_root ? HIST_ALL : HIST_SHNET;
+	snprintf(key->name, sizeof(key->name), "%s", shared_p->name);
+}
+
+/*! \brief Store counters of a range or shared network to slot. */
+static void history_store(struct history_map *map, uint32_t block, uint32_t slot,
+			  double defined, double used, double touched, double backups)
+{
+	struct history_series *s = series_at(map, block);
+	struct history_record *r;
+
+	r = series_records(s) + slot;
+	r->defined = defined;
+	r->used = used;
+	r->touched = touched;
+	r->backups = backups;
+	if (backups)
+		s->has_backups = 1;
+}
+
+/*! \brief Append counters from do_counting() to the history file.  Series
+ * are looked up from a hash, and blocks of series that are new in this
+ * run are added with one file extension and mapping. */
+void history_append(struct conf_t *state)
+{
+	struct history_map map;
+	struct history_index *entries, *e, *found;
+	struct history_series *s;
+	struct range_t *range_p;
+	struct shared_network_t *shared_p;
+	uint32_t i, j, slot, num_series, num_old, num_entries = state->num_ranges;
+
+	history_open(state, &map, 1);
+	if (map.hdr->ip_version != (uint32_t)state->ip_version) {
+		if (map.hdr->count != 0)
+			error(EXIT_FAILURE, 0, "history_append: %s: ip version mismatch",
+			      state->history_file);
+		map.hdr->ip_version = state->ip_version;
+	}
+	/* Find blocks of the series, and number the new ones. */
+	for (shared_p = state->shared_net_root; shared_p; shared_p = shared_p->next)
+		num_entries++;
+	entries = xcalloc(num_entries, sizeof(struct history_index));
+	for (i = 0, range_p = state->ranges; i < state->num_ranges; i++, range_p++)
+		range_key(&entries[i].key, range_p);
+	for (shared_p = state->shared_net_root; shared_p; shared_p = shared_p->next, i++)
+		shnet_key(state, &entries[i].key, shared_p);
+	history_index_build(&map);
+	num_series = num_old = map.hdr->num_series;
+	for (i = 0, e = entries; i < num_entries; i++, e++) {
+		HASH_FIND(hh, map.index, &e->key, sizeof(struct history_series), found);
+		if (found)
+			e->block = found->block;
+		else {
+			e->block = num_series++;
+			HASH_ADD(hh, map.index, key, sizeof(struct history_series), e);
+		}
+	}
+	if (num_old < num_series) {
+		if (ftruncate(map.fd, map_size(map.hdr->capacity, num_series)))
+			error(EXIT_FAILURE, errno, "history_append: ftruncate %s",
+			      state->history_file);
+		history_mmap(&map, map_size(map.hdr->capacity, num_series));
+		for (i = 0, e = entries; i < num_entries; i++, e++) {
+			if (e->block < num_old)
+				continue;
+			s = series_at(&map, e->block);
+			*s = e->key;
+			for (j = 0; j < map.hdr->capacity; j++)
+				series_records(s)[j].defined = NAN;
+		}
+		map.hdr->num_series = num_series;
+	}
+	slot = map.hdr->head;
+	/* Mark everything missing, present series are overwritten below. */
+	for (i = 0; i < num_old; i++)
+		series_records(series_at(&map, i))[slot].defined = NAN;
+	for (i = 0, range_p = state->ranges; i < state->num_ranges; i++, range_p++)
+		history_store(&map, entries[i].block, slot, get_range_size(range_p),
+			      range_p->count, range_p->touched, range_p->backups);
+	for (shared_p = state->shared_net_root; shared_p; shared_p = shared_p->next, i++)
+		history_store(&map, entries[i].block, slot, shared_p->available, shared_p->used,
+			      shared_p->touched, shared_p->backups);
+	ring_times(&map)[slot] = time(NULL);
+	map.hdr->head = (slot + 1) % map.hdr->capacity;
+	if (map.hdr->count < map.hdr->capacity)
+		map.hdr->count++;
+	if (msync(map.hdr, map.size, MS_SYNC))
+		error(EXIT_FAILURE, errno, "history_append: msync %s", state->history_file);
+	history_close(&map);
+	free(entries);
+}
+
+/*! \brief Convert logical ring index, where zero is the oldest sample, to
+ * slot number. */
+static uint32_t ring_slot(const struct history_header *hdr, uint32_t i)
+{
+	return (hdr->head + hdr->capacity - hdr->count + i) % hdr->capacity;
+}
+
+/*! \brief Binary search the oldest sample that is not older than since.
+ * \return Logical ring index. */
+static uint32_t ring_search(struct history_map *map, int64_t since)
+{
+	uint32_t lo = 0, hi = map->hdr->count;
+
+	while (lo < hi) {
+		uint32_t mid = lo + (hi - lo) / 2;
+
+		if (ring_times(map)[ring_slot(map->hdr, mid)] < since)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
+/*! \brief Check if series matches with --history-query selector.
+ * \param addr Selector as an address, or NULL when it is a name. */
+static int series_selected(struct conf_t *state, struct history_series *s,
+			   const union ipaddr_t *addr)
+{
+	if (state->history_select == NULL)
+		return 1;
+	if (!strcmp(s->name, state->history_select))
+		return 1;
+	if (s->type == HIST_RANGE && addr)
+		return ipcomp(&s->first_ip, addr) <= 0 && ipcomp(addr, &s->last_ip) <= 0;
+	return 0;
+}
+
+/*! \brief Print one series, from logical ring index onwards. */
+static void output_series(struct conf_t *state, struct history_map *map,
+			  struct history_series *s, uint32_t from, const char output_format,
+			  FILE *outfile, int *sep)
+{
+	static const char *const type_names[] = {
+		[HIST_RANGE] = "range",
+		[HIST_SHNET] = "shared-network",
+		[HIST_ALL] = "summary"
+	};
+	struct history_record *r;
+	uint32_t i, nsamples = 0;
+	int64_t t;
+
+	switch (output_format) {
+	case 't':
+		if (s->type == HIST_RANGE) {
+			fprintf(outfile, "%s %s", s->name, ntop_ipaddr(&s->first_ip));
+			fprintf(outfile, " - %s:\n", ntop_ipaddr(&s->last_ip));
+		} else
+			fprintf(outfile, "%s:\n", s->name);
+		fprintf(outfile, "time                          max   cur     percent  touch    t+c  t+c perc");
+		if (state->backups_found)
+			fprintf(outfile, "     bu  bu perc");
+		fprintf(outfile, "\n");
+		break;
+	case 'j':
+		fprintf(outfile, "%s         { \"type\":\"%s\", \"location\":\"%s\", ",
+			*sep ? ",\n" : "", type_names[s->type], s->name);
+		if (s->type == HIST_RANGE) {
+			fprintf(outfile, "\"first_ip\":\"%s\", ", ntop_ipaddr(&s->first_ip));
+			fprintf(outfile, "\"last_ip\":\"%s\", ", ntop_ipaddr(&s->last_ip));
+		}
+		fprintf(outfile, "\"samples\": [");
+		break;
+	}
+	*sep = 1;
+	for (i = from; i < map->hdr->count; i++) {
+		uint32_t slot = ring_slot(map->hdr, i);
+		double percent, tcp;
+
+		r = series_records(s) + slot;
+		if (isnan(r->defined))
+			continue;
+		t = ring_times(map)[slot];
+		percent = 100 * (double)r->used / r->defined;
+		tcp = 100 * ((double)r->touched + r->used) / r->defined;
+		switch (output_format) {
+		case 't':
+			dp_time_print(outfile, t, 0);
+			fprintf(outfile, " %9g %5" PRIu32 " %10.3f %7" PRIu32 " %6" PRIu32 " %9.3f",
+				r->defined, r->used, percent, r->touched,
+				r->touched + r->used, tcp);
+			if (state->backups_found)
+				fprintf(outfile, "%7" PRIu32 " %8.3f", r->backups,
+					100 * (double)r->backups / r->defined);
+			fprintf(outfile, "\n");
+			break;
+		case 'c':
+			fprintf(outfile, "\"%s\",\"%s\",", type_names[s->type], s->name);
+			if (s->type == HIST_RANGE) {
+				fprintf(outfile, "\"%s\",", ntop_ipaddr(&s->first_ip));
+				fprintf(outfile, "\"%s\",", ntop_ipaddr(&s->last_ip));
+			} else
+				fprintf(outfile, "\"\",\"\",");
+			fprintf(outfile, "\"");
+			dp_time_print(outfile, t, 1);
+			fprintf(outfile, "\",\"%g\",\"%" PRIu32 "\",\"%.3f\",\"%" PRIu32 "\",\"%" PRIu32
+				"\",\"%.3f\",\"%" PRIu32 "\"\n", r->defined, r->used, percent,
+				r->touched, r->touched + r->used, tcp, r->backups);
+			break;
+		case 'j':
+			fprintf(outfile, "%s\n            { \"time\":", nsamples ? "," : "");
+			dp_time_print(outfile, t, 1);
+			fprintf(outfile, ", \"defined\":%g, \"used\":%" PRIu32 ", \"touched\":%" PRIu32
+				", \"free\":%g, \"percent\":%g, \"touch_count\":%" PRIu32
+				", \"touch_percent\":%g", r->defined, r->used, r->touched,
+				r->defined - r->used, percent, r->touched + r->used, tcp);
+			if (state->backups_found)
+				fprintf(outfile, ", \"backup_count\":%" PRIu32, r->backups);
+			fprintf(outfile, " }");
+			break;
+		}
+		nsamples++;
+	}
+	switch (output_format) {
+	case 't':
+		fprintf(outfile, "\n");
+		break;
+	case 'j':
+		fprintf(outfile, "\n         ] }");
+		break;
+	}
+}
+
+/*! \brief Print samples from history file that are within the query
+ * window, instead of analysing dhcpd files.
+ * \return Exit value of the command. */
+int history_query(struct conf_t *state, const char output_format)
+{
+	struct history_map map;
+	struct history_series **selected;
+	union ipaddr_t addr;
+	const union ipaddr_t *select_ip = NULL;
+	FILE *outfile;
+	uint32_t i, from, num_selected = 0;
+	int sep = 0;
+
+	switch (output_format) {
+	case 't':
+	case 'c':
+	case 'j':
+		break;
+	case 'J':
+		return history_query(state, 'j');
+	default:
+		error(EXIT_FAILURE, 0, "history_query: unsupported output format: '%c'",
+		      output_format);
+	}
+	if (history_open(state, &map, 0) < 0)
+		error(EXIT_FAILURE, errno, "history_query: %s", state->history_file);
+	set_ipv_functions(state, map.hdr->ip_version);
+	if (state->history_select && parse_ipaddr(state, state->history_select, &addr))
+		select_ip = &addr;
+	/* Only descriptors are read to select series.  Backup columns are
+	 * printed if a selected series has had backups. */
+	selected = xmalloc(sizeof(struct history_series *) *
+			   (map.hdr->num_series ? map.hdr->num_series : 1));
+	for (i = 0; i < map.hdr->num_series; i++) {
+		struct history_series *s = series_at(&map, i);
+
+		if (!series_selected(state, s, select_ip))
+			continue;
+		selected[num_selected++] = s;
+		if (s->has_backups)
+			state->backups_found = 1;
+	}
+	from = ring_search(&map, time(NULL) - state->history_window);
+	if (state->output_file) {
+		outfile = fopen(state->output_file, "w+");
+		if (outfile == NULL)
+			error(EXIT_FAILURE, errno, "history_query: %s", state->output_file);
+	} else
+		outfile = stdout;
+	switch (output_format) {
+	case 'c':
+		fprintf(outfile, "\"type\",\"name\",\"first ip\",\"last ip\",\"time\",\"max\","
+			"\"cur\",\"percent\",\"touch\",\"t+c\",\"t+c perc\",\"bu\"\n");
+		break;
+	case 'j':
+		fprintf(outfile, "{\n   \"history\": [\n");
+		break;
+	}
+	for (i = 0; i < num_selected; i++)
+		output_series(state, &map, selected[i], from, output_format, outfile, &sep);
+	free(selected);
+	if (output_format == 'j')
+		fprintf(outfile, "\n   ]\n}\n");
+	if (outfile == stdout) {
+		if (fflush(stdout))
+			error(EXIT_FAILURE, errno, "history_query: fflush");
+	} else if (close_stream(outfile))
+		error(EXIT_FAILURE, errno, "history_query: fclose");
+	history_close(&map);
+	return 0;
+}
@@ -0,0 +1,361 @@
+/*
+ * The dhcpd-pools has BSD 2-clause license which also known as "Simplified
+ * BSD License" or "FreeBSD License".
+ *
+ * Copyright 2006- Sami Kerola. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the
+ *       distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR AND CONTRIBUTORS OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing
+ * official policies, either expressed or implied, of Sami Kerola.
+ */
+
+
+/*! \file http.c
+ * \brief Minimal HTTP/1.1 listener for metrics scraping.
+ *
+ * The listener serves /metrics in prometheus format, /json in json
+ * format, and /healthz.  Responses are rendered to memory when the dhcpd
+ * files have changed since the previous request, so that repeated scrapes
+ * cost only the socket write.  Clients are served concurrently from a
+ * poll() loop, every connection is closed after the response, and clients
+ * that do not finish within a deadline are cut off.
+ */
+
+#include <config.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "error.h"
+#include "xalloc.h"
+
+#include "dhcpd-pools.h"
+
+/*! \def HTTP_REQUEST_MAX
+ * \brief Maximum size of request headers. */
+#define HTTP_REQUEST_MAX 8192
+
+/*! \def HTTP_TIMEOUT
+ * \brief Seconds a client may take to send request and receive response. */
+#define HTTP_TIMEOUT 5
+
+/*! \def HTTP_MAX_CLIENTS
+ * \brief Number of clients served at the same time. */
+#define HTTP_MAX_CLIENTS 64
+
+/*! \struct http_page
+ * \brief A pre-rendered response body. */
+struct http_page {
+	const char *path;		/*!< Request path. */
+	const char *content_type;	/*!< Value of Content-Type header. */
+	char format;			/*!< Output format, or zero for static body. */
+	char *body;			/*!< Rendered body. */
+	size_t len;			/*!< Length of the body. */
+};
+
+/*! \struct http_conn
+ * \brief A client connection. */
+struct http_conn {
+	int fd;
+	time_t deadline;		/*!< When the client is dropped. */
+	char req[HTTP_REQUEST_MAX + 1];	/*!< Request read so far. */
+	size_t len;			/*!< Length of the request. */
+	char *out;			/*!< Response, or NULL while reading request. */
+	size_t out_len;			/*!< Length of the response. */
+	size_t out_pos;			/*!< Bytes of the response written. */
+};
+
+/*! \brief Render a page with an output format writer. */
+static void http_render(struct conf_t *state, struct http_page *page)
+{
+	free(page->body);
+	page->body = NULL;
+	page->len = 0;
+	state->output_stream = open_memstream(&page->body, &page->len);
+	if (state->output_stream == NULL)
+		error(EXIT_FAILURE, errno, "http_render: open_memstream");
+	/* the writer closes the stream, which finalizes body and len */
+	output_analysis(state, page->format);
+	state->output_stream = NULL;
+}
+
+/*! \brief Open listening socket.
+ * \param spec Either unix:PATH, PORT, HOST:PORT, or [HOST]:PORT for IPv6
+ * addresses.  Default host is localhost.
+ * \return Socket file descriptor. */
+static int http_listen(const char *spec)
+{
+	struct addrinfo hints = { 0 }, *res, *ai;
+	struct sockaddr_un sun = { 0 };
+	char *copy, *host, *port;
+	int fd = -1, one = 1, ret;
+
+	if (!strncmp(spec, "unix:", 5)) {
+		if (sizeof(sun.sun_path) <= strlen(spec + 5))
+			error(EXIT_FAILURE, 0, "http_listen: too long path: %s", spec + 5);
+		sun.sun_family = AF_UNIX;
+		strcpy(sun.sun_path, spec + 5);
+		unlink(sun.sun_path);
+		if ((fd = socket(AF_UNIX, SOCK_STREAM, 0)) < 0)
+			error(EXIT_FAILURE, errno, "http_listen: socket");
+		if (bind(fd, (struct sockaddr *)&sun, sizeof(sun)))
+			error(EXIT_FAILURE, errno, "http_listen: bind %s", spec + 5);
+	} else {
+		host = copy = xstrdup(spec);
+		if (*host == '[') {
+			/* [2001:db8::1]:9100 */
+			host++;
+			port = strchr(host, ']');
+			if (port == NULL || port[1] != ':')
+				error(EXIT_FAILURE, 0, "http_listen: %s: expected [HOST]:PORT", spec);
+			*port = '\0';
+			port += 2;
+		} else if ((port = strrchr(host, ':')) != NULL) {
+			*port++ = '\0';
+		} else {
+			port = host;
+			host = NULL;
+		}
+		hints.ai_family = AF_UNSPEC;
+		hints.ai_socktype = SOCK_STREAM;
+		hints.ai_flags = AI_NUMERICSERV;
+		ret = getaddrinfo(host ? host : "localhost", port, &hints, &res);
+		if (ret)
+			error(EXIT_FAILURE, 0, "http_listen: %s: %s", spec, gai_strerror(ret));
+		for (ai = res; ai; ai = ai->ai_next) {
+			if ((fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol)) < 0)
+				continue;
+			setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+			if (bind(fd, ai->ai_addr, ai->ai_addrlen) == 0)
+				break;
+			close(fd);
+			fd = -1;
+		}
+		freeaddrinfo(res);
+		free(copy);
+		if (fd < 0)
+			error(EXIT_FAILURE, errno, "http_listen: bind %s", spec);
+	}
+	if (listen(fd, 16))
+		error(EXIT_FAILURE, errno, "http_listen: listen");
+	return fd;
+}
+
+/*! \brief Set a descriptor to non-blocking mode. */
+static void http_nonblock(int fd)
+{
+	int flags = fcntl(fd, F_GETFL);
+
+	if (flags < 0 || fcntl(fd, F_SETFL, flags | O_NONBLOCK))
+		error(EXIT_FAILURE, errno, "http_nonblock: fcntl");
+}
+
+/*! \brief Queue response headers and body to be written to client.  The
+ * body is copied, so that pages can be rendered again while the response
+ * is still being written. */
+static void http_respond(struct http_conn *c, const char *status, const char *content_type,
+			 const char *body, size_t len, int head)
+{
+	char hdr[256];
+	int n;
+
+	n = snprintf(hdr, sizeof(hdr),
+		     "HTTP/1.1 %s\r\nContent-Type: %s\r\nContent-Length: %zu\r\n"
+		     "Connection: close\r\n\r\n", status, content_type, len);
+	if (head)
+		len = 0;
+	c->out = xmalloc(n + len);
+	memcpy(c->out, hdr, n);
+	memcpy(c->out + n, body, len);
+	c->out_len = n + len;
+	c->out_pos = 0;
+}
+
+/*! \brief Answer a complete request of a client. */
+static void http_request(struct conf_t *state, struct http_conn *c, struct file_stamp *stamp,
+			 struct http_page *pages, size_t num_pages)
+{
+	char *path, *end;
+	size_t i;
+	int head;
+
+	/* request headers are read, but only request line is used */
+	head = !strncmp(c->req, "HEAD ", 5);
+	if (strncmp(c->req, "GET ", 4) && !head) {
+		http_respond(c, "405 Method Not Allowed", "text/plain", "method not allowed\n",
+			     19, 0);
+		return;
+	}
+	path = c->req + (head ? 5 : 4);
+	if ((end = strpbrk(path, " ?\r\n")) != NULL)
+		*end = '\0';
+	for (i = 0; i < num_pages; i++) {
+		if (strcmp(path, pages[i].path))
+			continue;
+		if (refresh_analysis(state, stamp, 0)) {
+			for (size_t j = 0; j < num_pages; j++)
+				if (pages[j].format)
+					http_render(state, &pages[j]);
+		}
+		http_respond(c, "200 OK", pages[i].content_type, pages[i].body,
+			     pages[i].len, head);
+		return;
+	}
+	http_respond(c, "404 Not Found", "text/plain", "not found\n", 10, head);
+}
+
+/*! \brief Read from or write to a client that is ready.
+ * \return Zero while the connection is in use, -1 when it is done. */
+static int http_client(struct conf_t *state, struct http_conn *c, struct file_stamp *stamp,
+		       struct http_page *pages, size_t num_pages)
+{
+	ssize_t n;
+
+	if (c->out == NULL) {
+		n = read(c->fd, c->req + c->len, HTTP_REQUEST_MAX - c->len);
+		if (n < 0 && (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK))
+			return 0;
+		if (n <= 0)
+			return -1;
+		c->len += n;
+		c->req[c->len] = '\0';
+		if (!strstr(c->req, "\r\n\r\n") && !strstr(c->req, "\n\n")
+		    && c->len < HTTP_REQUEST_MAX)
+			return 0;
+		http_request(state, c, stamp, pages, num_pages);
+	}
+	while (c->out_pos < c->out_len) {
+		n = write(c->fd, c->out + c->out_pos, c->out_len - c->out_pos);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+			return 0;
+		if (n <= 0)
+			return -1;
+		c->out_pos += n;
+	}
+	return -1;
+}
+
+/*! \brief Close a client connection. */
+static void http_close(struct http_conn *c)
+{
+	close(c->fd);
+	free(c->out);
+	c->fd = -1;
+	c->out = NULL;
+}
+
+/*! \brief Serve metrics until the process is killed.  Clients are served
+ * concurrently by a poll() loop, and a client that has not received its
+ * response within HTTP_TIMEOUT seconds from connecting is dropped.
+ * \return Does not return. */
+int http_serve(struct conf_t *state)
+{
+	struct http_page pages[] = {
+		{ "/metrics", "text/plain; version=0.0.4", 'P', NULL, 0 },
+		{ "/json", "application/json", 'j', NULL, 0 },
+		{ "/healthz", "text/plain", 0, xstrdup("ok\n"), 3 }
+	};
+	const size_t num_pages = sizeof(pages) / sizeof(pages[0]);
+	struct file_stamp stamp = { 0 };
+	struct http_conn *conns;
+	struct pollfd pfd[HTTP_MAX_CLIENTS + 1];
+	unsigned int i, j, n, num_conns = 0;
+	time_t now, first;
+	int fd, client, timeout, listening;
+
+	signal(SIGPIPE, SIG_IGN);
+	/* fail early when dhcpd files are not usable */
+	refresh_analysis(state, &stamp, 0);
+	http_render(state, &pages[0]);
+	http_render(state, &pages[1]);
+	fd = http_listen(state->listen);
+	http_nonblock(fd);
+	conns = xcalloc(HTTP_MAX_CLIENTS, sizeof(struct http_conn));
+	while (1) {
+		/* listen only when there is room for a new client */
+		n = 0;
+		listening = num_conns < HTTP_MAX_CLIENTS;
+		if (listening) {
+			pfd[n].fd = fd;
+			pfd[n++].events = POLLIN;
+		}
+		first = 0;
+		for (i = 0; i < num_conns; i++, n++) {
+			pfd[n].fd = conns[i].fd;
+			pfd[n].events = conns[i].out ? POLLOUT : POLLIN;
+			if (first == 0 || conns[i].deadline < first)
+				first = conns[i].deadline;
+		}
+		now = time(NULL);
+		timeout = first == 0 ? -1 : first <= now ? 0 : (int)(first - now) * 1000;
+		if (poll(pfd, n, timeout) < 0) {
+			if (errno == EINTR)
+				continue;
+			error(EXIT_FAILURE, errno, "http_serve: poll");
+		}
+		now = time(NULL);
+		/* serve ready clients, and drop the ones that are done or late */
+		for (i = 0, j = 0; i < num_conns; i++) {
+			if ((pfd[listening + i].revents
+			     && http_client(state, &conns[i], &stamp, pages, num_pages) < 0)
+			    || conns[i].deadline <= now) {
+				http_close(&conns[i]);
+				continue;
+			}
+			conns[j++] = conns[i];
+		}
+		num_conns = j;
+		if (listening && pfd[0].revents) {
+			client = accept(fd, NULL, NULL);
+			if (client < 0) {
+				if (errno == EINTR || errno == ECONNABORTED || errno == EAGAIN
+				    || errno == EWOULDBLOCK)
+					continue;
+				error(EXIT_FAILURE, errno, "http_serve: accept");
+			}
+			http_nonblock(client);
+			memset(&conns[num_conns], 0, sizeof(struct http_conn));
+			conns[num_conns].fd = client;
+			conns[num_conns].deadline = now + HTTP_TIMEOUT;
+			num_conns++;
+		}
+	}
+	return EXIT_FAILURE;
+}
@@ -0,0 +1,440 @@
+/*
+ * The dhcpd-pools has BSD 2-clause license which also known as "Simplified
+ * BSD License" or "FreeBSD License".
+ *
+ * Copyright 2006- Sami Kerola. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the
+ *       distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR AND CONTRIBUTORS OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing
+ * official policies, either expressed or implied, of Sami Kerola.
+ */
+
+
+/*! \file lookup.c
+ * \brief Address lookup from a persisted index.
+ *
+ * A normal run can save the sorted ranges and the final lease states to an
+ * index file.  The file is a header followed by arrays of fixed size
+ * range and lease records, both sorted by address, and a table of shared
+ * network names.  Lookups map the file and binary search the arrays, so
+ * that dhcpd files do not need to be parsed.  When the index is missing,
+ * or the dhcpd files have changed or cannot be accessed since it was built,
+ * the files are parsed, and the index is built in memory and saved for
+ * next time.  The index uses host byte order and is not portable between
+ * machines.
+ */
+
+#include <config.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "close-stream.h"
+#include "error.h"
+#include "xalloc.h"
+
+#include "dhcpd-pools.h"
+
+/*! \def LOOKUP_MAGIC
+ * \brief Index file identifier, including format version.
+ */
+#define LOOKUP_MAGIC "DPLOOK03"
+
+/*! \struct lookup_header
+ * \brief The index file header.
+ */
+struct lookup_header {
+	char magic[8];
+	uint32_t ip_version;		/*!< The dhcp_version of the data. */
+	uint32_t num_ranges;		/*!< Number of lookup_range records. */
+	uint32_t num_leases;		/*!< Number of lookup_lease records. */
+	uint32_t names_size;		/*!< Size of shared network name table. */
+	uint32_t pad;
+	int64_t source_mtime;		/*!< Newest modification time of dhcpd files. */
+	uint64_t source_size;		/*!< Sum of dhcpd file sizes. */
+	uint64_t source_ino;		/*!< Combination of dhcpd file inode numbers. */
+};
+
+/*! \struct lookup_range
+ * \brief A range in the index.
+ */
+struct lookup_range {
+	union ipaddr_t first_ip;
+	union ipaddr_t last_ip;
+	union ipaddr_t max_last;	/*!< Highest last_ip of this and earlier ranges. */
+	uint32_t name;			/*!< Offset of shared network name. */
+	uint32_t pad;
+};
+
+/*! \struct lookup_lease
+ * \brief Final state of a lease in the index.
+ */
+struct lookup_lease {
+	union ipaddr_t ip;
+	uint8_t mac[MAC_LEN];
+	uint8_t type;			/*!< The ltype of the lease. */
+	uint8_t has_mac;
+};
+
+/*! \struct lookup_index
+ * \brief An index either mapped from file, or built to memory.
+ */
+struct lookup_index {
+	struct lookup_header *hdr;
+	size_t size;
+	int mapped;
+};
+
+/*! \brief Ranges right after the header. */
+static struct lookup_range *index_ranges(struct lookup_index *idx)
+{
+	return (struct lookup_range *)(idx->hdr + 1);
+}
+
+/*! \brief Leases after the ranges. */
+static struct lookup_lease *index_leases(struct lookup_index *idx)
+{
+	return (struct lookup_lease *)(index_ranges(idx) + idx->hdr->num_ranges);
+}
+
+/*! \brief Shared network names after the leases. */
+static const char *index_names(struct lookup_index *idx)
+{
+	return (const char *)(index_leases(idx) + idx->hdr->num_leases);
+}
+
+/*! \brief Size of an index file. */
+static size_t index_size(uint32_t num_ranges, uint32_t num_leases, uint32_t names_size)
+{
+	return sizeof(struct lookup_header) + num_ranges * sizeof(struct lookup_range) +
+	    num_leases * sizeof(struct lookup_lease) + names_size;
+}
+
+/*! \brief Record state of dhcpd.conf and lease files to header fields.
+ * Modification times have one second granularity, so sizes catch files
+ * that are appended, and inode numbers files that are replaced, within
+ * the second the index was built.
+ * \return Zero on success, or -1 when a file cannot be accessed. */
+static int source_stamp(struct conf_t *state, struct lookup_header *hdr)
+{
+	struct stat st;
+	unsigned int i;
+
+	hdr->source_mtime = 0;
+	hdr->source_size = 0;
+	hdr->source_ino = 0;
+	for (i = 0; i <= state->num_lease_files; i++) {
+		if (stat(i ? state->lease_files[i - 1] : state->dhcpdconf_file, &st))
+			return -1;
+		if (hdr->source_mtime < st.st_mtime)
+			hdr->source_mtime = st.st_mtime;
+		hdr->source_size += st.st_size;
+		hdr->source_ino = hdr->source_ino * 31 + st.st_ino;
+	}
+	return 0;
+}
+
+/*! \brief Build index of analysed data to memory.  Ranges and leases
+ * must be sorted by prepare_data() before calling this function. */
+static void index_build(struct conf_t *state, struct lookup_index *idx)
+{
+	struct shared_network_t *shared_p;
+	struct lookup_range *r;
+	struct lookup_lease *ll;
+	struct leases_t *l;
+	uint32_t names_size = 0, num_leases, *name_offs;
+	unsigned int i, num_shnets;
+	char *names;
+
+	num_shnets = number_shnets(state);
+	for (shared_p = state->shared_net_root; shared_p; shared_p = shared_p->next)
+		names_size += strlen(shared_p->name) + 1;
+	num_leases = HASH_COUNT(state->leases);
+	idx->size = index_size(state->num_ranges, num_leases, names_size);
+	idx->hdr = xcalloc(idx->size, 1);
+	idx->mapped = 0;
+	memcpy(idx->hdr->magic, LOOKUP_MAGIC, sizeof(idx->hdr->magic));
+	idx->hdr->ip_version = state->ip_version;
+	idx->hdr->num_ranges = state->num_ranges;
+	idx->hdr->num_leases = num_leases;
+	idx->hdr->names_size = names_size;
+	if (source_stamp(state, idx->hdr))
+		/* never matches, index is rebuilt when files are back */
+		idx->hdr->source_mtime = -1;
+	/* shared network names are saved once, and ranges refer to them */
+	names = (char *)index_names(idx);
+	name_offs = xmalloc(sizeof(uint32_t) * num_shnets);
+	names_size = 0;
+	for (i = 0, shared_p = state->shared_net_root; shared_p; i++, shared_p = shared_p->next) {
+		name_offs[i] = names_size;
+		strcpy(names + names_size, shared_p->name);
+		names_size += strlen(shared_p->name) + 1;
+	}
+	r = index_ranges(idx);
+	for (i = 0; i < state->num_ranges; i++, r++) {
+		copy_ipaddr(&r->first_ip, &state->ranges[i].first_ip);
+		copy_ipaddr(&r->last_ip, &state->ranges[i].last_ip);
+		copy_ipaddr(&r->max_last, &state->ranges[i].max_last);
+		r->name = name_offs[state->ranges[i].shared_net->number];
+	}
+	free(name_offs);
+	ll = index_leases(idx);
+	for (l = state->leases; l; l = l->hh.next, ll++) {
+		copy_ipaddr(&ll->ip, &l->ip);
+		ll->type = l->type;
+		if (l->ethernet
+		    && sscanf(l->ethernet, "%2hhx:%2hhx:%2hhx:%2hhx:%2hhx:%2hhx",
+			      &ll->mac[0], &ll->mac[1], &ll->mac[2], &ll->mac[3], &ll->mac[4],
+			      &ll->mac[5]) == MAC_LEN)
+			ll->has_mac = 1;
+	}
+}
+
+/*! \brief Save an index to file.  The file is replaced atomically, so
+ * that concurrent lookups see either old or new index. */
+static void index_save(struct conf_t *state, struct lookup_index *idx)
+{
+	char *tmpname;
+	FILE *out;
+
+	tmpname = xmalloc(strlen(state->index_file) + sizeof(".tmp"));
+	sprintf(tmpname, "%s.tmp", state->index_file);
+	out = fopen(tmpname, "w");
+	if (out == NULL)
+		error(EXIT_FAILURE, errno, "index_save: %s", tmpname);
+	if (fwrite(idx->hdr, idx->size, 1, out) != 1)
+		error(EXIT_FAILURE, errno, "index_save: %s", tmpname);
+	if (close_stream(out))
+		error(EXIT_FAILURE, errno, "index_save: %s", tmpname);
+	if (rename(tmpname, state->index_file))
+		error(EXIT_FAILURE, errno, "index_save: rename %s", state->index_file);
+	free(tmpname);
+}
+
+/*! \brief Map index file to memory.
+ * \return Zero on success, or -1 when index is missing, invalid, or the
+ * dhcpd files changed after it was built. */
+static int index_map(struct conf_t *state, struct lookup_index *idx)
+{
+	struct stat st;
+	struct lookup_header now;
+	int fd;
+
+	fd = open(state->index_file, O_RDONLY);
+	if (fd < 0)
+		return -1;
+	if (fstat(fd, &st) || (size_t)st.st_size < sizeof(struct lookup_header)) {
+		close(fd);
+		return -1;
+	}
+	idx->size = st.st_size;
+	idx->hdr = mmap(NULL, idx->size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (idx->hdr == MAP_FAILED)
+		return -1;
+	idx->mapped = 1;
+	if (memcmp(idx->hdr->magic, LOOKUP_MAGIC, sizeof(idx->hdr->magic))
+	    || idx->size != index_size(idx->hdr->num_ranges, idx->hdr->num_leases,
+					idx->hdr->names_size)
+	    || source_stamp(state, &now)
+	    || idx->hdr->source_mtime != now.source_mtime
+	    || idx->hdr->source_size != now.source_size
+	    || idx->hdr->source_ino != now.source_ino) {
+		munmap(idx->hdr, idx->size);
+		return -1;
+	}
+	return 0;
+}
+
+/*! \brief Release index memory. */
+static void index_free(struct lookup_index *idx)
+{
+	if (idx->mapped)
+		munmap(idx->hdr, idx->size);
+	else
+		free(idx->hdr);
+}
+
+/*! \brief Find the range an address belongs to.
+ * \return Pointer to a range, or NULL when address is not in any range. */
+static struct lookup_range *index_find_range(struct lookup_index *idx, const union ipaddr_t *ip)
+{
+	struct lookup_range *ranges = index_ranges(idx);
+	long lo = 0, hi = (long)idx->hdr->num_ranges - 1, mid;
+
+	/* the last range that does not start after the address */
+	while (lo <= hi) {
+		mid = (lo + hi) / 2;
+		if (ipcomp(&ranges[mid].first_ip, ip) <= 0)
+			lo = mid + 1;
+		else
+			hi = mid - 1;
+	}
+	for (; 0 <= hi && ipcomp(ip, &ranges[hi].max_last) <= 0; hi--)
+		if (ipcomp(ip, &ranges[hi].last_ip) <= 0)
+			return ranges + hi;
+	return NULL;
+}
+
+/*! \brief Find lease of an address.
+ * \return Pointer to a lease, or NULL when address has no lease. */
+static struct lookup_lease *index_find_lease(struct lookup_index *idx, const union ipaddr_t *ip)
+{
+	struct lookup_lease *leases = index_leases(idx);
+	long lo = 0, hi = (long)idx->hdr->num_leases - 1, mid;
+	int cmp;
+
+	while (lo <= hi) {
+		mid = (lo + hi) / 2;
+		cmp = ipcomp(&leases[mid].ip, ip);
+		if (cmp == 0)
+			return leases + mid;
+		if (cmp < 0)
+			lo = mid + 1;
+		else
+			hi = mid - 1;
+	}
+	return NULL;
+}
+
+/*! \brief Printable lease state. */
+static const char *lease_state_name(const struct lookup_range *r, const struct lookup_lease *l)
+{
+	if (l == NULL)
+		return r ? "unused" : "unknown";
+	switch (l->type) {
+	case ACTIVE:
+		return "active";
+	case FREE:
+		return "free";
+	case BACKUP:
+		return "backup";
+	}
+	return "unknown";
+}
+
+/*! \brief Save index of analysed data, called after a normal run. */
+void lookup_write(struct conf_t *state)
+{
+	struct lookup_index idx;
+
+	index_build(state, &idx);
+	index_save(state, &idx);
+	index_free(&idx);
+}
+
+/*! \brief Print range, shared network, lease state, and hardware address
+ * of addresses.  Answers come from index file when it is up to date,
+ * otherwise dhcpd files are analysed.
+ * \param addrs Addresses to look up.
+ * \param num_addrs Number of addresses.
+ * \return Exit value of the command. */
+int lookup_query(struct conf_t *state, const char output_format, char **addrs, int num_addrs)
+{
+	struct lookup_index idx;
+	FILE *outfile;
+	int i, ret = 0, sep = 0;
+
+	switch (output_format) {
+	case 't':
+	case 'j':
+		break;
+	case 'J':
+		return lookup_query(state, 'j', addrs, num_addrs);
+	default:
+		error(EXIT_FAILURE, 0, "lookup_query: unsupported output format: '%c'",
+		      output_format);
+	}
+	if (state->index_file == NULL || index_map(state, &idx) < 0) {
+		parse_config(state, 1, state->dhcpdconf_file, state->shared_net_root);
+		parse_lease_files(state, 1);
+		prepare_data(state);
+		index_build(state, &idx);
+		if (state->index_file)
+			index_save(state, &idx);
+	}
+	set_ipv_functions(state, idx.hdr->ip_version);
+	if (state->output_file) {
+		outfile = fopen(state->output_file, "w+");
+		if (outfile == NULL)
+			error(EXIT_FAILURE, errno, "lookup_query: %s", state->output_file);
+	} else
+		outfile = stdout;
+	if (output_format == 'j')
+		fprintf(outfile, "{\n   \"lookup\": [");
+	for (i = 0; i < num_addrs; i++) {
+		union ipaddr_t addr;
+		struct lookup_range *r = NULL;
+		struct lookup_lease *l = NULL;
+		const char *name;
+
+		if (state->ip_version == IPvUNKNOWN || !parse_ipaddr(state, addrs[i], &addr)) {
+			error(0, 0, "lookup_query: invalid address: %s", addrs[i]);
+			ret = 1;
+			continue;
+		}
+		r = index_find_range(&idx, &addr);
+		l = index_find_lease(&idx, &addr);
+		name = r ? index_names(&idx) + r->name : "";
+		if (output_format == 't') {
+			fprintf(outfile, "%s\t", addrs[i]);
+			if (r) {
+				fprintf(outfile, "%s - ", ntop_ipaddr(&r->first_ip));
+				fprintf(outfile, "%s\t", ntop_ipaddr(&r->last_ip));
+			} else
+				fputs("-\t", outfile);
+			fprintf(outfile, "%s\t%s\t%s\n", r ? name : "-", lease_state_name(r, l),
+				l && l->has_mac ? ntop_mac(l->mac) : "-");
+			continue;
+		}
+		fprintf(outfile, "%s\n         { \"ip\":\"%s\", ", sep ? "," : "", addrs[i]);
+		sep = 1;
+		if (r) {
+			fprintf(outfile, "\"range\":\"%s - ", ntop_ipaddr(&r->first_ip));
+			fprintf(outfile, "%s\", ", ntop_ipaddr(&r->last_ip));
+		} else
+			fputs("\"range\":\"\", ", outfile);
+		fprintf(outfile, "\"location\":\"%s\", \"state\":\"%s\", \"macaddress\":\"%s\" }",
+			name, lease_state_name(r, l), l && l->has_mac ? ntop_mac(l->mac) : "");
+	}
+	if (output_format == 'j')
+		fprintf(outfile, "\n   ]\n}\n");
+	if (outfile == stdout) {
+		if (fflush(stdout))
+			error(EXIT_FAILURE, errno, "lookup_query: fflush");
+	} else if (close_stream(outfile))
+		error(EXIT_FAILURE, errno, "lookup_query: fclose");
+	index_free(&idx);
+	return ret;
+}
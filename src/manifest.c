@@ -0,0 +1,421 @@
+/*
+ * The dhcpd-pools has BSD 2-clause license which also known as "Simplified
+ * BSD License" or "FreeBSD License".
+ *
+ * Copyright 2006- Sami Kerola. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the
+ *       distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR AND CONTRIBUTORS OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing
+ * official policies, either expressed or implied, of Sami Kerola.
+ */
+
+
+/*! \file manifest.c
+ * \brief Analysis of many dhcpd instances listed in a manifest file.
+ *
+ * Every manifest line has dhcpd.conf path, comma separated dhcpd.leases
+ * paths, and a label.  Instances are analyzed in parallel on a thread
+ * pool, with run time state of their own, and their outputs are printed
+ * in manifest order.  Each worker has a queue of instances, largest input
+ * first, and a worker that runs out of work steals the smallest instance
+ * from an other queue.  Results are the same regardless of the number of
+ * threads.  An instance whose files cannot be read is reported with its
+ * error, and the other instances are analyzed as usual.
+ */
+
+#include <config.h>
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef HAVE_PTHREAD
+# include <pthread.h>
+#endif
+
+#include "close-stream.h"
+#include "error.h"
+#include "xalloc.h"
+
+#include "dhcpd-pools.h"
+
+/*! \struct manifest_entry
+ * \brief A dhcpd instance, and its result. */
+struct manifest_entry {
+	char *label;			/*!< Name of the instance in output. */
+	char *conf_file;		/*!< Path to dhcpd.conf file. */
+	const char **lease_files;	/*!< Paths to dhcpd.leases files. */
+	unsigned int num_lease_files;	/*!< Number of lease files. */
+	off_t weight;			/*!< Input size, used to schedule large instances first. */
+	char *error;			/*!< Reason the instance was not analyzed, or NULL. */
+	char *out;			/*!< Rendered output. */
+	size_t out_len;			/*!< Length of rendered output. */
+	int ret;			/*!< Return value of output format writer. */
+};
+
+/*! \struct manifest_order
+ * \brief Sort key of scheduling order. */
+struct manifest_order {
+	unsigned int index;		/*!< Entry index. */
+	off_t weight;			/*!< Copy of entry weight. */
+};
+
+/*! \struct manifest_queue
+ * \brief Work queue of a worker.  The owner takes from head, and other
+ * workers steal from tail. */
+struct manifest_queue {
+#ifdef USE_THREADS
+	pthread_mutex_t lock;
+#endif
+	unsigned int *items;		/*!< Entry indexes. */
+	unsigned int head;		/*!< Next item of the owner. */
+	unsigned int tail;		/*!< One past last item. */
+};
+
+/*! \struct manifest_pool
+ * \brief State shared by workers. */
+struct manifest_pool {
+	struct conf_t *state;		/*!< Command line settings. */
+	char output_format;		/*!< Output format of instances. */
+	struct manifest_entry *entries;
+	unsigned int num_entries;
+	struct manifest_queue *queues;
+	unsigned int num_workers;
+};
+
+/*! \struct manifest_worker
+ * \brief Argument of a worker thread. */
+struct manifest_worker {
+	struct manifest_pool *pool;
+	unsigned int id;
+};
+
+/*! \brief Check that a file of an instance can be read, and record the
+ * first failure as the instance error. */
+static void manifest_check(struct manifest_entry *e, const char *path)
+{
+	const char *msg;
+
+	if (e->error || access(path, R_OK) == 0)
+		return;
+	msg = strerror(errno);
+	e->error = xmalloc(strlen(path) + strlen(msg) + sizeof(": "));
+	sprintf(e->error, "%s: %s", path, msg);
+}
+
+/*! \brief Read manifest file.  Empty lines, and lines starting with hash
+ * are ignored. */
+static void manifest_read(struct manifest_pool *pool, const char *path)
+{
+	FILE *f;
+	char *line = NULL, *word[3], *p, *save;
+	size_t len = 0, size = 16;
+	unsigned int lineno = 0, n, i;
+	struct manifest_entry *e;
+	struct stat st;
+
+	if ((f = fopen(path, "r")) == NULL)
+		error(EXIT_FAILURE, errno, "manifest_read: %s", path);
+	pool->entries = xmalloc(sizeof(struct manifest_entry) * size);
+	while (getline(&line, &len, f) != -1) {
+		lineno++;
+		for (n = 0, p = line; n < 3; n++, p = NULL)
+			if ((word[n] = strtok_r(p, " \t\r\n", &save)) == NULL)
+				break;
+		if (n == 0 || word[0][0] == '#')
+			continue;
+		if (n != 3 || strtok_r(NULL, " \t\r\n", &save))
+			error(EXIT_FAILURE, 0, "manifest_read: %s:%u: expected config, leases, and label",
+			      path, lineno);
+		for (i = 0; i < pool->num_entries; i++)
+			if (!strcmp(pool->entries[i].label, word[2]))
+				error(EXIT_FAILURE, 0, "manifest_read: %s:%u: duplicate label: %s",
+				      path, lineno, word[2]);
+		if (pool->num_entries == size) {
+			size *= 2;
+			pool->entries = xrealloc(pool->entries, sizeof(struct manifest_entry) * size);
+		}
+		e = &pool->entries[pool->num_entries++];
+		memset(e, 0, sizeof(struct manifest_entry));
+		e->label = xstrdup(word[2]);
+		e->conf_file = xstrdup(word[0]);
+		manifest_check(e, e->conf_file);
+		if (!stat(e->conf_file, &st))
+			e->weight += st.st_size;
+		for (p = strtok_r(word[1], ",", &save); p; p = strtok_r(NULL, ",", &save)) {
+			e->lease_files = xrealloc(e->lease_files,
+						  sizeof(char *) * (e->num_lease_files + 1));
+			e->lease_files[e->num_lease_files++] = xstrdup(p);
+			manifest_check(e, p);
+			if (!stat(p, &st))
+				e->weight += st.st_size;
+		}
+	}
+	if (ferror(f))
+		error(EXIT_FAILURE, errno, "manifest_read: %s", path);
+	free(line);
+	fclose(f);
+	if (pool->num_entries == 0)
+		error(EXIT_FAILURE, 0, "manifest_read: %s: no instances", path);
+}
+
+/*! \brief Analyze an instance, and render its output to memory. */
+static void manifest_analyze(struct manifest_pool *pool, struct manifest_entry *e)
+{
+	struct conf_t inst = *pool->state;
+	struct shared_network_t *root;
+
+	if (e->error) {
+		e->ret = EXIT_FAILURE;
+		return;
+	}
+	/* Command line settings are shared, results are instance local. */
+	inst.dhcpdconf_file = e->conf_file;
+	inst.lease_files = e->lease_files;
+	inst.num_lease_files = e->num_lease_files;
+	inst.dhcpdlease_file = e->lease_files[0];
+	inst.lease_times = pool->state->lease_times || 1 < e->num_lease_files;
+	inst.leases = NULL;
+	inst.macs = NULL;
+	inst.include_files = NULL;
+	inst.num_include_files = 0;
+	memset(&inst.include_stamp, 0, sizeof(inst.include_stamp));
+	inst.pools = inst.classes = NULL;
+	inst.num_pools = 0;
+	inst.num_ranges = 0;
+	inst.ranges_size = 64;
+	inst.backups_found = 0;
+	inst.dup_across_ranges = inst.dup_in_range = 0;
+	inst.output_file = NULL;
+	memset(&inst.stats, 0, sizeof(inst.stats));
+	prepare_memory(&inst);
+	set_ipv_functions(&inst, IPvUNKNOWN);
+
+	parse_config(&inst, 1, inst.dhcpdconf_file, inst.shared_net_root);
+	parse_lease_files(&inst, pool->output_format == 'X' || pool->output_format == 'J'
+			  || inst.duplicates);
+	prepare_data(&inst);
+	do_counting(&inst);
+	if (inst.duplicates)
+		count_duplicates(&inst);
+	if (inst.sorts != NULL)
+		mergesort_ranges(&inst, inst.ranges, inst.num_ranges, NULL, 1);
+	if (inst.reverse_order == 1)
+		flip_ranges(&inst);
+	inst.output_stream = open_memstream(&e->out, &e->out_len);
+	if (inst.output_stream == NULL)
+		error(EXIT_FAILURE, errno, "manifest_analyze: open_memstream");
+	e->ret = output_analysis(&inst, pool->output_format);
+
+	reset_analysis(&inst);
+	root = inst.shared_net_root;
+	free(root->name);
+	free(root);
+	free(inst.ranges);
+}
+
+#ifdef USE_THREADS
+/*! \brief Take work from own queue head, or steal from tail of an other
+ * queue.
+ * \return Entry index, or -1 when all queues are empty. */
+static int manifest_take(struct manifest_pool *pool, unsigned int id)
+{
+	struct manifest_queue *q;
+	unsigned int i;
+	int item = -1;
+
+	for (i = 0; i < pool->num_workers && item < 0; i++) {
+		q = &pool->queues[(id + i) % pool->num_workers];
+		pthread_mutex_lock(&q->lock);
+		if (q->head < q->tail)
+			item = i == 0 ? q->items[q->head++] : q->items[--q->tail];
+		pthread_mutex_unlock(&q->lock);
+	}
+	return item;
+}
+
+/*! \brief Worker thread main loop.  No work is added while workers run,
+ * so empty queues mean the work is done. */
+static void *manifest_worker(void *arg)
+{
+	struct manifest_worker *w = arg;
+	int item;
+
+	while ((item = manifest_take(w->pool, w->id)) >= 0)
+		manifest_analyze(w->pool, &w->pool->entries[item]);
+	return NULL;
+}
+#endif
+
+/*! \brief Compare manifest entries by weight, largest first, and
+ * in manifest order when weights are equal. */
+static int manifest_order_cmp(const void *a, const void *b)
+{
+	const struct manifest_order *oa = a, *ob = b;
+
+	if (oa->weight != ob->weight)
+		return oa->weight < ob->weight ? 1 : -1;
+	return (oa->index > ob->index) - (oa->index < ob->index);
+}
+
+/*! \brief Print a json string with quotes and escapes. */
+static void manifest_json_string(FILE *outfile, const char *s)
+{
+	fputc('"', outfile);
+	for (; *s; s++) {
+		if (*s == '"' || *s == '\\')
+			fputc('\\', outfile);
+		fputc(*s, outfile);
+	}
+	fputc('"', outfile);
+}
+
+/*! \brief Run analysis on all instances of the manifest file.
+ * \return Largest return value of the instances output format writer. */
+int manifest_run(struct conf_t *state, const char output_format)
+{
+	struct manifest_pool pool = { .state = state, .output_format = output_format };
+	struct manifest_entry *e;
+	struct manifest_order *order;
+	unsigned int i, j;
+	FILE *outfile;
+	int json = output_format == 'j' || output_format == 'J', ret = 0;
+#ifdef USE_THREADS
+	struct manifest_worker *workers;
+	pthread_t *threads;
+	long cpus;
+	int err;
+#endif
+
+	manifest_read(&pool, state->manifest_file);
+	order = xmalloc(sizeof(struct manifest_order) * pool.num_entries);
+	for (i = 0; i < pool.num_entries; i++) {
+		order[i].index = i;
+		order[i].weight = pool.entries[i].weight;
+	}
+	qsort(order, pool.num_entries, sizeof(struct manifest_order), manifest_order_cmp);
+#ifdef USE_THREADS
+	pool.num_workers = state->num_jobs;
+	if (pool.num_workers == 0) {
+		cpus = sysconf(_SC_NPROCESSORS_ONLN);
+		pool.num_workers = cpus < 1 ? 1 : cpus;
+	}
+	if (pool.num_entries < pool.num_workers)
+		pool.num_workers = pool.num_entries;
+	/* deal instances to queues, so each queue is in weight order */
+	pool.queues = xcalloc(pool.num_workers, sizeof(struct manifest_queue));
+	for (i = 0; i < pool.num_workers; i++) {
+		pthread_mutex_init(&pool.queues[i].lock, NULL);
+		pool.queues[i].items = xmalloc(sizeof(unsigned int) * pool.num_entries);
+	}
+	for (i = 0; i < pool.num_entries; i++) {
+		struct manifest_queue *q = &pool.queues[i % pool.num_workers];
+
+		q->items[q->tail++] = order[i].index;
+	}
+	workers = xmalloc(sizeof(struct manifest_worker) * pool.num_workers);
+	threads = xmalloc(sizeof(pthread_t) * pool.num_workers);
+	for (i = 0; i < pool.num_workers; i++) {
+		workers[i].pool = &pool;
+		workers[i].id = i;
+		err = pthread_create(&threads[i], NULL, manifest_worker, &workers[i]);
+		if (err)
+			error(EXIT_FAILURE, err, "manifest_run: pthread_create");
+	}
+	for (i = 0; i < pool.num_workers; i++) {
+		err = pthread_join(threads[i], NULL);
+		if (err)
+			error(EXIT_FAILURE, err, "manifest_run: pthread_join");
+	}
+	for (i = 0; i < pool.num_workers; i++) {
+		pthread_mutex_destroy(&pool.queues[i].lock);
+		free(pool.queues[i].items);
+	}
+	free(pool.queues);
+	free(workers);
+	free(threads);
+	/* workers changed function pointers of their own threads only */
+#else
+	for (i = 0; i < pool.num_entries; i++)
+		manifest_analyze(&pool, &pool.entries[order[i].index]);
+	set_ipv_functions(state, state->ip_version);
+#endif
+	free(order);
+
+	if (state->output_file) {
+		outfile = fopen(state->output_file, "w+");
+		if (outfile == NULL)
+			error(EXIT_FAILURE, errno, "manifest_run: %s", state->output_file);
+	} else
+		outfile = stdout;
+	if (json)
+		fputs("{\n", outfile);
+	for (i = 0; i < pool.num_entries; i++) {
+		e = &pool.entries[i];
+		if (json) {
+			if (i)
+				fputs(",\n", outfile);
+			manifest_json_string(outfile, e->label);
+			fputs(": ", outfile);
+			/* drop trailing new line of instance output */
+			while (e->out_len && e->out[e->out_len - 1] == '\n')
+				e->out_len--;
+		} else
+			fprintf(outfile, "%s[%s]\n", i ? "\n" : "", e->label);
+		if (e->error) {
+			error(0, 0, "manifest_run: %s: %s", e->label, e->error);
+			if (json) {
+				fputs("{ \"error\": ", outfile);
+				manifest_json_string(outfile, e->error);
+				fputs(" }", outfile);
+			} else
+				fprintf(outfile, "error: %s\n", e->error);
+			free(e->error);
+		}
+		fwrite(e->out, 1, e->out_len, outfile);
+		if (ret < e->ret)
+			ret = e->ret;
+		free(e->out);
+		free(e->label);
+		free(e->conf_file);
+		for (j = 0; j < e->num_lease_files; j++)
+			free((char *)e->lease_files[j]);
+		free(e->lease_files);
+	}
+	if (json)
+		fputs("\n}\n", outfile);
+	free(pool.entries);
+	if (outfile == stdout) {
+		if (fflush(stdout))
+			error(EXIT_FAILURE, errno, "manifest_run: fflush");
+	} else if (close_stream(outfile))
+		error(EXIT_FAILURE, errno, "manifest_run: fclose");
+	return ret;
+}
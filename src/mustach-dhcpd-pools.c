@@ -40,6 +40,7 @@
 #include <config.h>
 
 #include <fcntl.h>
+#include <inttypes.h>
 #include <errno.h>
 #include <error.h>
 #include <stdlib.h>
@@ -60,6 +61,8 @@ struct expl {
 	struct conf_t *state;
 	struct range_t *range_p;
 	struct shared_network_t *shnet_p;
+	struct macs_t *mac_p;
+	struct tombstone_t *tomb_p;
 	struct output_helper_t oh;
 	int current;
 };
@@ -82,17 +85,12 @@ static int must_put_base(void *closure, const char *name, int escape
 		return 0;
 	}
 	if (!strcmp(name, "number_of_shared_networks")) {
-		static uint32_t num = 0xffffffff;
+		struct shared_network_t *shared_p;
+		uint32_t num = 0;
 
-		if (num == 0xffffffff) {
-			/* Use of static num ensures this is done only once. */
-			struct shared_network_t *shared_p;
-
-			num = 0;
-			for (shared_p = e->state->shared_net_root->next; shared_p;
-			     shared_p = shared_p->next)
-				num++;
-		}
+		for (shared_p = e->state->shared_net_root->next; shared_p;
+		     shared_p = shared_p->next)
+			num++;
 		fprintf(file, "%u", num);
 		return 0;
 	}
@@ -100,6 +98,18 @@ static int must_put_base(void *closure, const char *name, int escape
 		fprintf(file, "%s", PACKAGE_VERSION);
 		return 0;
 	}
+	if (!strcmp(name, "lease_time_buckets")) {
+		output_lease_hist_bounds(file);
+		return 0;
+	}
+	if (!strcmp(name, "duplicate_clients_across_ranges")) {
+		fprintf(file, "%u", e->state->dup_across_ranges);
+		return 0;
+	}
+	if (!strcmp(name, "duplicate_clients_in_range")) {
+		fprintf(file, "%u", e->state->dup_in_range);
+		return 0;
+	}
 	/* lease file */
 	if (!strcmp(name, "lease_file_path")) {
 		fprintf(file, "%s", e->state->dhcpdlease_file);
@@ -145,7 +155,7 @@ static int must_put_base(void *closure, const char *name, int escape
 
 /*! \struct mustach_itf
  * \brief Mustach function pointers. */
-static struct mustach_itf itf = {
+static THREAD_LOCAL struct mustach_itf itf = {
 	.start = NULL,
 	.enter = must_enter,
 	.put = must_put_base,
@@ -153,6 +163,37 @@ static struct mustach_itf itf = {
 	.leave = must_leave
 };
 
+/*! \brief Print range fragmentation tags.
+ * \return Zero when name was a fragmentation tag. */
+static int must_put_fragmentation(const struct range_bitmap_t *b, const char *name, FILE *file)
+{
+	union ipaddr_t ip;
+
+	if (!strcmp(name, "free_blocks")) {
+		fprintf(file, "%" PRIu32, b->free_blocks);
+		return 0;
+	}
+	if (!strcmp(name, "largest_free_block")) {
+		fprintf(file, "%" PRIu32, b->largest_free);
+		return 0;
+	}
+	if (!strcmp(name, "used_blocks")) {
+		fprintf(file, "%" PRIu32, b->used_blocks);
+		return 0;
+	}
+	if (!strcmp(name, "largest_free_first_ip"))
+		ip.v4 = b->largest_free ? b->largest_free_first : 0;
+	else if (!strcmp(name, "first_used_ip"))
+		ip.v4 = b->has_used ? b->first_used : 0;
+	else if (!strcmp(name, "last_used_ip"))
+		ip.v4 = b->has_used ? b->last_used : 0;
+	else
+		return 1;
+	if (ip.v4)
+		fprintf(file, "%s", ntop_ipaddr(&ip));
+	return 0;
+}
+
 /*!  \brief Mustach range aka {{#subnets}} tag parser and printer. */
 static int must_put_range(void *closure, const char *name, int escape
 			  __attribute__ ((unused)), FILE *file)
@@ -176,6 +217,11 @@ static int must_put_range(void *closure, const char *name, int escape
 		fprintf(file, "%s", ntop_ipaddr(&e->range_p->last_ip));
 		return 0;
 	}
+	if (!strcmp(name, "prefix_length")) {
+		if (e->range_p->prefix_len)
+			fprintf(file, "%d", e->range_p->prefix_len);
+		return 0;
+	}
 	if (!strcmp(name, "used")) {
 		fprintf(file, "%g", e->range_p->count);
 		return 0;
@@ -218,6 +264,20 @@ static int must_put_range(void *closure, const char *name, int escape
 		fprintf(file, "%d", e->oh.status);
 		return 0;
 	}
+	if (!strcmp(name, "lease_time_histogram")) {
+		output_lease_hist(file, e->range_p->lease_hist);
+		return 0;
+	}
+	if (!strcmp(name, "growth_per_hour")) {
+		fprintf(file, "%g", e->range_p->growth_rate * 3600);
+		return 0;
+	}
+	if (!strcmp(name, "exhaustion_hours")) {
+		fprintf(file, "%g", e->range_p->eta / 3600);
+		return 0;
+	}
+	if (e->range_p->bitmap && !must_put_fragmentation(e->range_p->bitmap, name, file))
+		return 0;
 	if (!strcmp(name, "gettimeofday")) {
 		dp_time_tool(file, NULL, 1);
 		return 0;
@@ -282,6 +342,18 @@ static int must_put_shnet(void *closure, const char *name, int escape
 		fprintf(file, "%d", e->oh.status);
 		return 0;
 	}
+	if (!strcmp(name, "lease_time_histogram")) {
+		output_lease_hist(file, e->shnet_p->lease_hist);
+		return 0;
+	}
+	if (!strcmp(name, "growth_per_hour")) {
+		fprintf(file, "%g", e->shnet_p->growth_rate * 3600);
+		return 0;
+	}
+	if (!strcmp(name, "exhaustion_hours")) {
+		fprintf(file, "%g", e->shnet_p->eta / 3600);
+		return 0;
+	}
 	if (!strcmp(name, "gettimeofday")) {
 		dp_time_tool(file, NULL, 1);
 		return 0;
@@ -294,6 +366,64 @@ static int must_put_shnet(void *closure, const char *name, int escape
 	return 1;
 }
 
+/*!  \brief Mustach duplicate clients aka {{#duplicate-clients}} tag parser
+ * and printer. */
+static int must_put_dup(void *closure, const char *name, int escape
+			__attribute__ ((unused)), FILE *file)
+{
+	struct expl *e = closure;
+
+	if (!strcmp(name, "macaddress")) {
+		fprintf(file, "%s", ntop_mac(e->mac_p->mac));
+		return 0;
+	}
+	if (!strcmp(name, "leases")) {
+		fprintf(file, "%u", e->mac_p->count);
+		return 0;
+	}
+	if (!strcmp(name, "ranges")) {
+		fprintf(file, "%u", e->mac_p->ranges);
+		return 0;
+	}
+	if (!strcmp(name, "ips")) {
+		struct leases_t *l;
+
+		for (l = e->mac_p->leases; l; l = l->mac_next)
+			fprintf(file, "%s%s", ntop_ipaddr(&l->ip), l->mac_next ? " " : "");
+		return 0;
+	}
+	error(EXIT_FAILURE, 0, "mustach_dhcpd_pools: fmustach: unexpected tag: %s", name);
+	return 1;
+}
+
+/*! \brief Mustach removed aka {{#removed}} tag parser and printer. */
+static int must_put_tomb(void *closure, const char *name, int escape
+			 __attribute__ ((unused)), FILE *file)
+{
+	struct expl *e = closure;
+
+	if (!strcmp(name, "type")) {
+		fputs(e->tomb_p->is_range ? "range" : "shared-network", file);
+		return 0;
+	}
+	if (!strcmp(name, "location")) {
+		fputs(e->tomb_p->name, file);
+		return 0;
+	}
+	if (!strcmp(name, "first_ip")) {
+		if (e->tomb_p->is_range)
+			fputs(ntop_ipaddr(&e->tomb_p->first_ip), file);
+		return 0;
+	}
+	if (!strcmp(name, "last_ip")) {
+		if (e->tomb_p->is_range)
+			fputs(ntop_ipaddr(&e->tomb_p->last_ip), file);
+		return 0;
+	}
+	error(EXIT_FAILURE, 0, "mustach_dhcpd_pools: fmustach: unexpected tag: %s", name);
+	return 1;
+}
+
 /*!  \brief A function to move to next range when {{/subnets}} is encountered. */
 static int must_next_range(void *closure)
 {
@@ -304,7 +434,7 @@ static int must_next_range(void *closure)
 		e->current--;
 		if (e->current <= 0)
 			return 0;
-	} while (range_output_helper(e->state, &e->oh, e->range_p));
+	} while (range_output_helper(e->state, &e->oh, e->range_p) || e->range_p->unchanged);
 	return 1;
 }
 
@@ -320,7 +450,7 @@ static int must_next_shnet(void *closure)
 		e->shnet_p = e->shnet_p->next;
 		if (e->shnet_p == NULL)
 			break;
-		if (shnet_output_helper(e->state, &e->oh, e->shnet_p))
+		if (shnet_output_helper(e->state, &e->oh, e->shnet_p) || e->shnet_p->unchanged)
 			continue;
 		else
 			return 1;
@@ -328,6 +458,30 @@ static int must_next_shnet(void *closure)
 	return 0;
 }
 
+/*!  \brief A function to move to next client when {{/duplicate-clients}} is
+ * encountered. */
+static int must_next_dup(void *closure)
+{
+	struct expl *e = closure;
+
+	while (e->mac_p) {
+		e->mac_p = e->mac_p->hh.next;
+		if (e->mac_p && 1 < e->mac_p->count)
+			return 1;
+	}
+	return 0;
+}
+
+/*!  \brief A function to move to next tombstone when {{/removed}} is
+ * encountered. */
+static int must_next_tomb(void *closure)
+{
+	struct expl *e = closure;
+
+	e->tomb_p++;
+	return e->tomb_p < e->state->tombstones + e->state->num_tombstones;
+}
+
 /*! \brief Function that is called when mustach is searching output loops from
  * template file.  */
 static int must_enter(void *closure, const char *name)
@@ -350,6 +504,32 @@ static int must_enter(void *closure, const char *name)
 		e->current = 0;
 		return must_next_shnet(closure);
 	}
+	if (!strcmp(name, "pools") || !strcmp(name, "classes")) {
+		itf.put = must_put_shnet;
+		itf.next = must_next_shnet;
+		e->shnet_p = name[0] == 'p' ? e->state->pools : e->state->classes;
+		e->current = 0;
+		if (e->shnet_p == NULL)
+			return 0;
+		/* lists have no root entry, so check the first one here */
+		if (!shnet_output_helper(e->state, &e->oh, e->shnet_p) && !e->shnet_p->unchanged)
+			return 1;
+		return must_next_shnet(closure);
+	}
+	if (!strcmp(name, "duplicate-clients")) {
+		itf.put = must_put_dup;
+		itf.next = must_next_dup;
+		e->mac_p = e->state->macs;
+		if (e->mac_p && 1 < e->mac_p->count)
+			return 1;
+		return must_next_dup(closure);
+	}
+	if (!strcmp(name, "removed")) {
+		itf.put = must_put_tomb;
+		itf.next = must_next_tomb;
+		e->tomb_p = e->state->tombstones;
+		return 0 < e->state->num_tombstones;
+	}
 	if (!strcmp(name, "summary")) {
 		itf.put = must_put_shnet;
 		itf.next = must_next_shnet;
@@ -404,7 +584,9 @@ int mustach_dhcpd_pools(struct conf_t *state)
 	int ret;
 
 	template = must_read_template(state->mustach_template);
-	if (state->output_file) {
+	if (state->output_stream) {
+		outfile = state->output_stream;
+	} else if (state->output_file) {
 		outfile = fopen(state->output_file, "w+");
 		if (outfile == NULL) {
 			error(EXIT_FAILURE, errno, "mustach_dhcpd_pools: fopen: %s",
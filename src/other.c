@@ -58,7 +58,7 @@
 
 #include "dhcpd-pools.h"
 
-char *(*cidr_last) (union ipaddr_t *restrict addr, const int mask);
+THREAD_LOCAL char *(*cidr_last) (union ipaddr_t *restrict addr, const int mask);
 static char *cidr_last_v4(union ipaddr_t *restrict addr, const int mask);
 static char *cidr_last_v6(union ipaddr_t *restrict addr, const int mask);
 
@@ -262,6 +262,22 @@ void parse_cidr(struct conf_t *state, struct range_t *range_p, const char *word)
 	free(last);
 }
 
+/*! \brief Set the delegated prefix length of a prefix6 range, and extend
+ * the last address to the end of the last prefix so that delegated
+ * prefixes are found with the same interval search as addresses.
+ * \param word Prefix length with a leading slash, such as /56. */
+void parse_prefix_len(struct range_t *range_p, const char *word)
+{
+	int mask, i;
+
+	mask = strtol_mask(word + (*word == '/'));
+	if (mask <= 0)
+		error(EXIT_FAILURE, 0, "prefix6 invalid prefix length %s", word);
+	range_p->prefix_len = mask;
+	for (i = mask; i < 128; i++)
+		range_p->last_ip.v6[i / 8] |= 0x80 >> (i % 8);
+}
+
 /*! \brief Copy IP address to union.
  *
  * \param dst Destination for a binary IP address.
@@ -291,14 +307,14 @@ void copy_ipaddr_v6(union ipaddr_t *restrict dst, const union ipaddr_t *restrict
  */
 const char *ntop_ipaddr_init(const union ipaddr_t *ip __attribute__ ((unused)))
 {
-	static char buffer = '\0';
+	static THREAD_LOCAL char buffer = '\0';
 
 	return &buffer;
 }
 
 const char *ntop_ipaddr_v4(const union ipaddr_t *ip)
 {
-	static char buffer[sizeof("255.255.255.255")];
+	static THREAD_LOCAL char buffer[sizeof("255.255.255.255")];
 	struct in_addr addr;
 
 	addr.s_addr = htonl(ip->v4);
@@ -307,7 +323,7 @@ const char *ntop_ipaddr_v4(const union ipaddr_t *ip)
 
 const char *ntop_ipaddr_v6(const union ipaddr_t *ip)
 {
-	static char buffer[sizeof("ffff:ffff:ffff:ffff:ffff:ffff:255.255.255.255")];
+	static THREAD_LOCAL char buffer[sizeof("ffff:ffff:ffff:ffff:ffff:ffff:255.255.255.255")];
 	struct in6_addr addr;
 
 	memcpy(addr.s6_addr, ip->v6, sizeof(addr.s6_addr));
@@ -330,11 +346,41 @@ double get_range_size_v4(const struct range_t *r)
 	return r->last_ip.v4 - r->first_ip.v4 + 1;
 }
 
+/*! \brief Number of delegated prefixes in a prefix6 range.  The address
+ * difference is computed with borrows over all 128 bits, and shifted down
+ * to prefix units before it is converted to floating point. */
+static double get_prefix_count_v6(const struct range_t *r)
+{
+	unsigned char diff[16];
+	const int bytes = (128 - r->prefix_len) / 8, bits = (128 - r->prefix_len) % 8;
+	int i, d, borrow = 0;
+	double count = 0;
+
+	for (i = 15; 0 <= i; i--) {
+		d = (int)r->last_ip.v6[i] - (int)r->first_ip.v6[i] - borrow;
+		borrow = d < 0;
+		diff[i] = (unsigned char)(d + (borrow ? 256 : 0));
+	}
+	for (i = 15; 0 <= i; i--) {
+		d = i - bytes < 0 ? 0 : diff[i - bytes] >> bits;
+		if (bits && 0 <= i - bytes - 1)
+			d |= diff[i - bytes - 1] << (8 - bits);
+		diff[i] = (unsigned char)d;
+	}
+	for (i = 0; i < 16; i++) {
+		count *= 256;
+		count += diff[i];
+	}
+	return count + 1;
+}
+
 double get_range_size_v6(const struct range_t *r)
 {
 	double size = 0;
 	int i;
 
+	if (r->prefix_len)
+		return get_prefix_count_v6(r);
 	/* When calculating the size of an IPv6 range overflow may occur.
 	 * In that case only the last LONG_BIT bits are preserved, thus
 	 * we just skip the first (16 - LONG_BIT) bits...  */
@@ -362,6 +408,10 @@ int xstrstr_init(struct conf_t *state, const char *restrict str)
 		set_ipv_functions(state, IPv6);
 		return PREFIX_LEASE;
 	}
+	if (!memcmp("  iaprefix ", str, 11)) {
+		set_ipv_functions(state, IPv6);
+		return PREFIX_IAPREFIX;
+	}
 	return NUM_OF_PREFIX;
 }
 
@@ -375,14 +425,23 @@ int
 #if __GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 3)
     __attribute__ ((hot))
 #endif
-    xstrstr_v4(struct conf_t *state __attribute__ ((unused)), const char *restrict str)
+    xstrstr_v4(struct conf_t *state, const char *restrict str)
 {
 	size_t len;
 
 	if (str[2] == 'b' || str[2] == 'h')
 		len = strlen(str);
-	else
+	else {
+		if (state->lease_times) {
+			if (str[2] == 's' && !memcmp("  starts ", str, 9))
+				return PREFIX_STARTS;
+			if (str[2] == 'e' && !memcmp("  ends ", str, 7))
+				return PREFIX_ENDS;
+			if (str[2] == 'c' && !memcmp("  cltt ", str, 7))
+				return PREFIX_CLTT;
+		}
 		len = 0;
+	}
 	if (15 < len) {
 		switch (str[16]) {
 		case 'f':
@@ -428,14 +487,21 @@ int
 #if __GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 3)
     __attribute__ ((hot))
 #endif
-    xstrstr_v6(struct conf_t *state __attribute__ ((unused)), const char *restrict str)
+    xstrstr_v6(struct conf_t *state, const char *restrict str)
 {
 	size_t len;
 
 	if (str[4] == 'b' || str[2] == 'h')
 		len = strlen(str);
-	else
+	else {
+		if (state->lease_times) {
+			if (str[4] == 'm' && !memcmp("    max-life ", str, 13))
+				return PREFIX_MAX_LIFE;
+			if (str[2] == 'c' && !memcmp("  cltt ", str, 7))
+				return PREFIX_CLTT;
+		}
 		len = 0;
+	}
 	if (17 < len) {
 		switch (str[18]) {
 		case 'f':
@@ -468,6 +534,8 @@ int
 	}
 	if (!memcmp("  iaaddr ", str, 9))
 		return PREFIX_LEASE;
+	if (!memcmp("  iaprefix ", str, 11))
+		return PREFIX_IAPREFIX;
 	return NUM_OF_PREFIX;
 }
 
@@ -510,6 +578,19 @@ double strtod_or_err(const char *restrict str, const char *restrict errmesg)
 	return 0;
 }
 
+/*! \brief Number shared networks in list order, all networks being zero,
+ * so that ranges can refer to their shared network by index.
+ * \return Number of shared networks. */
+unsigned int number_shnets(struct conf_t *state)
+{
+	struct shared_network_t *shared_p;
+	unsigned int n = 0;
+
+	for (shared_p = state->shared_net_root; shared_p; shared_p = shared_p->next)
+		shared_p->number = n++;
+	return n;
+}
+
 /*! \brief Reverse range.
  * Used before output, if a caller has requested reverse sorting. */
 void flip_ranges(struct conf_t *state)
@@ -524,26 +605,95 @@ void flip_ranges(struct conf_t *state)
 	free(tmp_ranges);
 }
 
+/*! \brief Free a linked list of shared networks, pools, or classes. */
+static void free_shnet_list(struct shared_network_t *c)
+{
+	struct shared_network_t *n;
+
+	for (; c; c = n) {
+		n = c->next;
+		free(c->name);
+		free(c->classes);
+		free(c);
+	}
+}
+
+/*! \brief Run time initialization. Global allocations, counter
+ * initializations, etc are here. */
+void prepare_memory(struct conf_t *state)
+{
+	state->ranges = xmalloc(sizeof(struct range_t) * state->ranges_size);
+	/* First shared network entry is all networks */
+	state->shared_net_root = xcalloc(sizeof(struct shared_network_t), 1);
+	state->shared_net_root->name = xstrdup("All networks");
+	state->shared_net_head = state->shared_net_root;
+}
+
+/*! \brief Forget files included by dhcpd.conf. */
+static void free_include_files(struct conf_t *state)
+{
+	unsigned int i;
+
+	for (i = 0; i < state->num_include_files; i++)
+		free(state->include_files[i]);
+	free(state->include_files);
+	state->include_files = NULL;
+	state->num_include_files = 0;
+	memset(&state->include_stamp, 0, sizeof(state->include_stamp));
+}
+
+/*! \brief Forget results of an analysis, so that dhcpd files can be
+ * analyzed again by a long running process.  Command line settings, and
+ * the all networks entry are kept. */
+void reset_analysis(struct conf_t *state)
+{
+	struct shared_network_t *root = state->shared_net_root;
+	char *name = root->name;
+
+	delete_all_leases(state);
+	spill_free(state);
+	bitmap_free(state);
+	free_shnet_list(root->next);
+	memset(root, 0, sizeof(struct shared_network_t));
+	root->name = name;
+	state->shared_net_head = root;
+	free_shnet_list(state->pools);
+	free_shnet_list(state->classes);
+	state->pools = state->classes = NULL;
+	state->num_pools = 0;
+	state->num_ranges = 0;
+	state->backups_found = 0;
+	state->dup_across_ranges = state->dup_in_range = 0;
+	memset(&state->stats, 0, sizeof(state->stats));
+	free_include_files(state);
+}
+
 /*! \brief Free memory, flush buffers etc. */
 void clean_up(struct conf_t *state)
 {
 	struct output_sort *cur, *next;
-	struct shared_network_t *c, *n;
+	unsigned int i;
 
 	/* Just in case there something in buffers */
 	if (fflush(NULL))
 		error(EXIT_FAILURE, errno, "clean_up: fflush");
+	bitmap_free(state);
 	free(state->ranges);
+	free(state->lease_files);
+	free_include_files(state);
 	delete_all_leases(state);
+	spill_free(state);
 	for (cur = state->sorts; cur; cur = next) {
 		next = cur->next;
 		free(cur);
 	}
-	for (c = state->shared_net_root; c; c = n) {
-		n = c->next;
-		free(c->name);
-		free(c);
-	}
+	free_shnet_list(state->shared_net_root);
+	free_shnet_list(state->pools);
+	free_shnet_list(state->classes);
+	for (i = 0; i < state->num_tombstones; i++)
+		free(state->tombstones[i].name);
+	free(state->tombstones);
+	shm_detach(state);
 }
 
 /*! \brief Print a time stamp of a path or now to output file. */
@@ -559,6 +709,13 @@ void dp_time_tool(FILE *file, const char *path, int epoch)
 		t = st.st_mtime;
 	} else
 		t = time(NULL);
+	dp_time_print(file, t, epoch);
+}
+
+/*! \brief Print a time stamp to output file either as epoch or in iso
+ * format. */
+void dp_time_print(FILE *file, time_t t, int epoch)
+{
 	/* epoc or iso time stamp */
 	if (epoch)
 		fprintf(file, "%ld", t);
@@ -605,8 +762,9 @@ void __attribute__ ((__noreturn__)) usage(int status)
 	fputs(		"This is ISC dhcpd pools usage analyzer.\n", out);
 	fputs(		"\n", out);
 	fputs(		"  -c, --config=FILE      path to the dhcpd.conf file\n", out);
-	fputs(		"  -l, --leases=FILE      path to the dhcpd.leases file\n", out);
-	fputs(		"  -f, --format=[thHcxXjJ] output format\n", out);
+	fputs(		"  -l, --leases=FILE      path to the dhcpd.leases file, can be repeated\n", out);
+	fputs(		"      --merge=cltt|state how to merge leases of multiple files\n", out);
+	fputs(		"  -f, --format=[thHcxXjJMP] output format\n", out);
 	fputs(		"                           t for text\n", out);
 	fputs(		"                           H for full html page\n", out);
 	fputs(		"                           x for xml\n", out);
@@ -614,6 +772,8 @@ void __attribute__ ((__noreturn__)) usage(int status)
 	fputs(		"                           j for json\n", out);
 	fputs(		"                           J for json with active lease details\n", out);
 	fputs(		"                           c for comma separated values\n", out);
+	fputs(		"                           M for munin multigraph\n", out);
+	fputs(		"                           P for prometheus exposition\n", out);
 #ifdef BUILD_MUSTACH
 	fputs(		"      --mustach=FILE     output using mustach template file\n", out);
 #endif
@@ -641,6 +801,36 @@ void __attribute__ ((__noreturn__)) usage(int status)
 	fputs(		"  -p, --perfdata         print additional perfdata in alarming mode\n", out);
 	fputs(		"  -A, --all-as-shared    treat single subnets as shared-network with CIDR as their name\n", out);
 	fputs(          "      --ip-version=4|6   force analysis to use either IPv4 or IPv6 functions\n", out);
+	fputs(		"      --lease-histogram  collect lease time histograms\n", out);
+	fputs(		"      --duplicates       report clients that have several active leases\n", out);
+	fputs(		"      --pools            count pools and classes they allow or deny\n", out);
+	fputs(		"      --index=FILE       save address lookup index to file\n", out);
+	fputs(		"      --lookup ADDR...   print range, state, and mac of addresses\n", out);
+	fputs(		"      --history=FILE     append usage counters to history file\n", out);
+	fputs(		"      --history-retention=NR\n", out);
+	fputs(		"                         number of samples a new history file keeps\n", out);
+	fputs(		"      --history-query=HOURS[,NAME|IP]\n", out);
+	fputs(		"                         print history instead of analysis\n", out);
+	fputs(		"      --forecast=FILE    estimate time to exhaustion, and save state to file\n", out);
+	fputs(		"      --warn-eta=HOURS   a time to exhaustion before warning raised\n", out);
+	fputs(		"      --crit-eta=HOURS   a time to exhaustion before critical raised\n", out);
+	fputs(		"      --benchmark=FILE   time output writers, and append timings to file\n", out);
+	fputs(		"      --stats            report phase timings, input volume, and memory use\n", out);
+	fputs(		"      --snmp-pass-persist[=OID]\n", out);
+	fputs(		"                         answer snmpd pass_persist requests from stdin\n", out);
+	fputs(		"      --listen=[HOST:]PORT|unix:PATH\n", out);
+	fputs(		"                         serve /metrics, /json, and /healthz over http\n", out);
+	fputs(		"      --shm=NAME         publish counters to shared memory segment\n", out);
+	fputs(		"      --manifest=FILE    analyze dhcpd instances listed in file\n", out);
+	fputs(		"      --jobs=NUM         number of threads in manifest mode\n", out);
+	fputs(		"      --changed-only=FILE\n", out);
+	fputs(		"                         print only entries that changed since run that saved file\n", out);
+	fputs(		"      --events=FILE      print lease state changes since run that saved file\n", out);
+	fputs(		"      --replay=MINUTES   print range usage over lease file lifetime at intervals\n", out);
+	fputs(		"      --only-net=CIDR    analyze only ranges that overlap with the network\n", out);
+	fputs(		"      --only-shared=NAME analyze only ranges of the shared network\n", out);
+	fputs(		"      --memory-limit=MB  keep leases in sorted temporary files over the limit\n", out);
+	fputs(		"      --fragmentation    report free and used address blocks of IPv4 ranges\n", out);
 	fputs(		"  -v, --version          output version information and exit\n", out);
 	fputs(		"  -h, --help             display this help and exit\n", out);
 	fputs(		"\n", out);
@@ -40,6 +40,7 @@
 #include <config.h>
 
 #include <arpa/inet.h>
+#include <ctype.h>
 #include <errno.h>
 #include <inttypes.h>
 #include <langinfo.h>
@@ -56,6 +57,7 @@
 #include "error.h"
 #include "progname.h"
 #include "strftime.h"
+#include "xalloc.h"
 
 #include "dhcpd-pools.h"
 
@@ -113,6 +115,12 @@ int range_output_helper(struct conf_t *state, struct output_helper_t *oh,
 	else if (state->warning < oh->percent
 		 && (oh->range_size - range_p->count) < state->warn_count)
 		oh->status = STATUS_WARN;
+	if (state->forecast_file) {
+		if (range_p->eta < state->crit_eta)
+			oh->status = STATUS_CRIT;
+		else if (oh->status == STATUS_OK && range_p->eta < state->warn_eta)
+			oh->status = STATUS_WARN;
+	}
 	if (oh->status != STATUS_OK) {
 		if (oh->range_size <= state->minsize) {
 			oh->status = STATUS_IGNORED;
@@ -158,11 +166,13 @@ int shnet_output_helper(struct conf_t *state, struct output_helper_t *oh,
 		oh->status = STATUS_IGNORED;
 		if (state->skip_minsize)
 			return 1;
-	} else if (state->critical < oh->percent && shared_p->used < state->crit_count) {
+	} else if ((state->critical < oh->percent && shared_p->used < state->crit_count)
+		   || (state->forecast_file && shared_p->eta < state->crit_eta)) {
 		oh->status = STATUS_CRIT;
 		if (state->skip_critical)
 			return 1;
-	} else if (state->warning < oh->percent && shared_p->used < state->warn_count) {
+	} else if ((state->warning < oh->percent && shared_p->used < state->warn_count)
+		   || (state->forecast_file && shared_p->eta < state->warn_eta)) {
 		oh->status = STATUS_WARN;
 		if (state->skip_warning)
 			return 1;
@@ -172,7 +182,64 @@ int shnet_output_helper(struct conf_t *state, struct output_helper_t *oh,
 			return 1;
 	}
 	return 0;
+}
+
+/*! \brief Print lease time histogram counts as comma separated list.
+ * \param f Output file descriptor.
+ * \param hist Histogram of a range or shared network.
+ */
+void output_lease_hist(FILE *f, const uint32_t *hist)
+{
+	int i;
+
+	for (i = 0; i < NUM_OF_LEASE_HIST; i++)
+		fprintf(f, "%s%" PRIu32, i ? "," : "", hist[i]);
+}
+
+/*! \brief Print lower limits, in seconds, of the lease time histogram
+ * buckets as comma separated list.
+ * \param f Output file descriptor.
+ */
+void output_lease_hist_bounds(FILE *f)
+{
+	int i;
+
+	fputc('0', f);
+	for (i = 1; i < NUM_OF_LEASE_HIST; i++)
+		fprintf(f, ",%lu", (unsigned long)LEASE_HIST_BASE << (i - 1));
+}
 
+/*! \brief Print growth forecast json fields.  Not finite numbers are
+ * quoted, similar to percentages of empty shared networks.
+ * \param f Output file descriptor.
+ * \param rate Growth of used addresses per second.
+ * \param eta Seconds to exhaustion.
+ * \param pre String printed before each field.
+ * \param post String printed after each field.
+ */
+static void json_forecast(FILE *f, double rate, double eta, const char *pre, const char *post)
+{
+	fprintf(f, "%s\"growth_per_hour\":%g,%s", pre, rate * 3600, post);
+	if (isfinite(eta))
+		fprintf(f, "%s\"exhaustion_hours\":%g,%s", pre, eta / 3600, post);
+	else
+		fprintf(f, "%s\"exhaustion_hours\":\"%g\",%s", pre, eta, post);
+}
+
+/*! \brief Print fragmentation statistics of a range as json members. */
+static void json_fragmentation(FILE *f, const struct range_bitmap_t *b)
+{
+	union ipaddr_t ip;
+
+	fprintf(f, "\"fragmentation\":{ \"free_blocks\":%" PRIu32 ", \"largest_free_block\":%"
+		PRIu32 ", ", b->free_blocks, b->largest_free);
+	ip.v4 = b->largest_free_first;
+	fprintf(f, "\"largest_free_first_ip\":\"%s\", ", b->largest_free ? ntop_ipaddr(&ip) : "");
+	fprintf(f, "\"used_blocks\":%" PRIu32 ", ", b->used_blocks);
+	ip.v4 = b->first_used;
+	fprintf(f, "\"first_used_ip\":\"%s\", ", b->has_used ? ntop_ipaddr(&ip) : "");
+	ip.v4 = b->last_used;
+	fprintf(f, "\"last_used_ip\":\"%s\" }, ", b->has_used ? ntop_ipaddr(&ip) : "");
 }
 
 /*! \brief Output a color based on output_helper_t status.
@@ -192,6 +259,8 @@ static FILE *open_outfile(struct conf_t *state)
 {
 	FILE *outfile;
 
+	if (state->output_stream)
+		return state->output_stream;
 	if (state->output_file) {
 		outfile = fopen(state->output_file, "w+");
 		if (outfile == NULL) {
@@ -216,12 +285,56 @@ static void close_outfile(FILE *outfile)
 	}
 }
 
+/*! \brief Print shared networks, pools, or classes in text format.
+ * \param title Section title.
+ * \param list First entry of a linked list. */
+static void txt_shnet_list(struct conf_t *state, FILE *outfile, const char *title,
+			   struct shared_network_t *list)
+{
+	struct shared_network_t *shared_p;
+	struct output_helper_t oh;
+
+	if (state->header_limit & S_BIT) {
+		fprintf(outfile, "%s\n", title);
+		fprintf(outfile,
+			"name                   max   cur     percent  touch    t+c  t+c perc");
+		if (state->backups_found == 1) {
+			fprintf(outfile, "     bu  bu perc");
+		}
+		fprintf(outfile, "\n");
+	}
+	if (state->number_limit & S_BIT) {
+		for (shared_p = list; shared_p; shared_p = shared_p->next) {
+			int color_set = 0;
+
+			if (shnet_output_helper(state, &oh, shared_p))
+				continue;
+			if (state->color_mode == color_on)
+				color_set = start_color(state, &oh, outfile);
+			fprintf(outfile,
+				"%-20s %5g %5g %10.3f %7g %6g %9.3f",
+				shared_p->name,
+				shared_p->available,
+				shared_p->used,
+				oh.percent,
+				shared_p->touched,
+				oh.tc,
+				oh.tcp);
+			if (state->backups_found == 1) {
+				fprintf(outfile, "%7g %8.3f", shared_p->backups, oh.bup);
+			}
+			if (color_set)
+				fputs(color_tags[COLOR_RESET][state->output_format], outfile);
+			fprintf(outfile, "\n");
+		}
+	}
+}
+
 /*! \brief Text output format, which is the default. */
 static int output_txt(struct conf_t *state)
 {
 	unsigned int i;
 	struct range_t *range_p;
-	struct shared_network_t *shared_p;
 	struct output_helper_t oh;
 	FILE *outfile;
 	int max_ipaddr_length = state->ip_version == IPv6 ? 39 : 16;
@@ -290,39 +403,12 @@ static int output_txt(struct conf_t *state)
 	if (state->number_limit & R_BIT && state->header_limit & S_BIT) {
 		fprintf(outfile, "\n");
 	}
-	if (state->header_limit & S_BIT) {
-		fprintf(outfile, "Shared networks:\n");
-		fprintf(outfile,
-			"name                   max   cur     percent  touch    t+c  t+c perc");
-		if (state->backups_found == 1) {
-			fprintf(outfile, "     bu  bu perc");
-		}
+	txt_shnet_list(state, outfile, "Shared networks:", state->shared_net_root->next);
+	if (state->pool_counting && (state->header_limit & S_BIT || state->number_limit & S_BIT)) {
 		fprintf(outfile, "\n");
-	}
-	if (state->number_limit & S_BIT) {
-		for (shared_p = state->shared_net_root->next; shared_p; shared_p = shared_p->next) {
-			int color_set = 0;
-
-			if (shnet_output_helper(state, &oh, shared_p))
-				continue;
-			if (state->color_mode == color_on)
-				color_set = start_color(state, &oh, outfile);
-			fprintf(outfile,
-				"%-20s %5g %5g %10.3f %7g %6g %9.3f",
-				shared_p->name,
-				shared_p->available,
-				shared_p->used,
-				oh.percent,
-				shared_p->touched,
-				oh.tc,
-				oh.tcp);
-			if (state->backups_found == 1) {
-				fprintf(outfile, "%7g %8.3f", shared_p->backups, oh.bup);
-			}
-			if (color_set)
-				fputs(color_tags[COLOR_RESET][state->output_format], outfile);
-			fprintf(outfile, "\n");
-		}
+		txt_shnet_list(state, outfile, "Pools:", state->pools);
+		fprintf(outfile, "\n");
+		txt_shnet_list(state, outfile, "Classes:", state->classes);
 	}
 	if (state->number_limit & S_BIT && state->header_limit & A_BIT) {
 		fprintf(outfile, "\n");
@@ -363,12 +449,34 @@ static int output_txt(struct conf_t *state)
 	return 0;
 }
 
+/*! \brief Print shared networks, pools, or classes in xml format.
+ * \param tag Element name of an entry.
+ * \param list First entry of a linked list. */
+static void xml_shnet_list(struct conf_t *state, FILE *outfile, const char *tag,
+			   struct shared_network_t *list)
+{
+	struct shared_network_t *shared_p;
+	struct output_helper_t oh;
+
+	for (shared_p = list; shared_p; shared_p = shared_p->next) {
+		if (shnet_output_helper(state, &oh, shared_p))
+			continue;
+		fprintf(outfile, "<%s>\n", tag);
+		fprintf(outfile, "\t<location>%s</location>\n", shared_p->name);
+		fprintf(outfile, "\t<defined>%g</defined>\n", shared_p->available);
+		fprintf(outfile, "\t<used>%g</used>\n", shared_p->used);
+		fprintf(outfile, "\t<touched>%g</touched>\n", shared_p->touched);
+		fprintf(outfile, "\t<free>%g</free>\n",
+			shared_p->available - shared_p->used);
+		fprintf(outfile, "</%s>\n", tag);
+	}
+}
+
 /*! \brief The xml output formats. */
 static int output_xml(struct conf_t *state, const int print_mac_addreses)
 {
 	unsigned int i;
 	struct range_t *range_p;
-	struct shared_network_t *shared_p;
 	struct output_helper_t oh;
 	FILE *outfile;
 
@@ -418,17 +526,10 @@ static int output_xml(struct conf_t *state, const int print_mac_addreses)
 	}
 
 	if (state->number_limit & S_BIT) {
-		for (shared_p = state->shared_net_root->next; shared_p; shared_p = shared_p->next) {
-			if (shnet_output_helper(state, &oh, shared_p))
-				continue;
-			fprintf(outfile, "<shared-network>\n");
-			fprintf(outfile, "\t<location>%s</location>\n", shared_p->name);
-			fprintf(outfile, "\t<defined>%g</defined>\n", shared_p->available);
-			fprintf(outfile, "\t<used>%g</used>\n", shared_p->used);
-			fprintf(outfile, "\t<touched>%g</touched>\n", shared_p->touched);
-			fprintf(outfile, "\t<free>%g</free>\n",
-				shared_p->available - shared_p->used);
-			fprintf(outfile, "</shared-network>\n");
+		xml_shnet_list(state, outfile, "shared-network", state->shared_net_root->next);
+		if (state->pool_counting) {
+			xml_shnet_list(state, outfile, "pool", state->pools);
+			xml_shnet_list(state, outfile, "class", state->classes);
 		}
 	}
 
@@ -448,12 +549,86 @@ static int output_xml(struct conf_t *state, const int print_mac_addreses)
 	return 0;
 }
 
+/*! \brief Print shared networks, pools, or classes as a json array.
+ * \param name Name of the array.
+ * \param list First entry of a linked list.
+ * \param forecast Print forecast fields, which exist only for shared networks. */
+static void json_shnet_list(struct conf_t *state, FILE *outfile, const char *name,
+			    struct shared_network_t *list, const int forecast)
+{
+	struct shared_network_t *shared_p;
+	struct output_helper_t oh;
+	int sep = 0;
+
+	fprintf(outfile, "   \"%s\": [\n", name);
+	for (shared_p = list; shared_p; shared_p = shared_p->next) {
+		if (shnet_output_helper(state, &oh, shared_p) || shared_p->unchanged)
+			continue;
+		/* separator before entry, so that skipped last entry is ok */
+		if (sep++)
+			fprintf(outfile, ",\n");
+		fprintf(outfile, "         ");
+		fprintf(outfile, "{ ");
+		fprintf(outfile, "\"location\":\"%s\", ", shared_p->name);
+		fprintf(outfile, "\"defined\":%g, ", shared_p->available);
+		fprintf(outfile, "\"used\":%g, ", shared_p->used);
+		fprintf(outfile, "\"touched\":%g, ", shared_p->touched);
+		fprintf(outfile, "\"free\":%g, ", shared_p->available - shared_p->used);
+		if (fpclassify(shared_p->available) == FP_ZERO)
+			fprintf(outfile, "\"percent\":\"%g\", ", oh.percent);
+		else
+			fprintf(outfile, "\"percent\":%g, ", oh.percent);
+		fprintf(outfile, "\"touch_count\":%g, ", oh.tc);
+		if (fpclassify(shared_p->available) == FP_ZERO)
+			fprintf(outfile, "\"touch_percent\":\"%g\", ", oh.tcp);
+		else
+			fprintf(outfile, "\"touch_percent\":%g, ", oh.tcp);
+		if (state->backups_found == 1) {
+			fprintf(outfile, "\"backup_count\":%g, ", shared_p->backups);
+			if (fpclassify(shared_p->available) == FP_ZERO)
+				fprintf(outfile, "\"backup_percent\":\"%g\", ", oh.bup);
+			else
+				fprintf(outfile, "\"backup_percent\":%g, ", oh.bup);
+		}
+		if (state->lease_histogram) {
+			fprintf(outfile, "\"lease_time_histogram\":[");
+			output_lease_hist(outfile, shared_p->lease_hist);
+			fprintf(outfile, "], ");
+		}
+		if (forecast && state->forecast_file)
+			json_forecast(outfile, shared_p->growth_rate, shared_p->eta, "", " ");
+		fprintf(outfile, "\"status\":%d }", oh.status);
+	}
+	if (sep)
+		fprintf(outfile, "\n");
+	fprintf(outfile, "   ]");	/* end of the array */
+}
+
+/*! \brief Print tombstones of --changed-only mode as a json array. */
+static void json_tombstones(struct conf_t *state, FILE *outfile)
+{
+	struct tombstone_t *t;
+	unsigned int i;
+
+	fprintf(outfile, "   \"removed\": [\n");
+	for (i = 0, t = state->tombstones; i < state->num_tombstones; i++, t++) {
+		if (t->is_range) {
+			fprintf(outfile, "         { \"range\":\"%s", ntop_ipaddr(&t->first_ip));
+			fprintf(outfile, " - %s\", ", ntop_ipaddr(&t->last_ip));
+			fprintf(outfile, "\"first_ip\":\"%s\", ", ntop_ipaddr(&t->first_ip));
+			fprintf(outfile, "\"last_ip\":\"%s\" }", ntop_ipaddr(&t->last_ip));
+		} else
+			fprintf(outfile, "         { \"location\":\"%s\" }", t->name);
+		fprintf(outfile, i + 1 < state->num_tombstones ? ",\n" : "\n");
+	}
+	fprintf(outfile, "   ]");	/* end of removed */
+}
+
 /*! \brief The json output formats. */
 static int output_json(struct conf_t *state, const int print_mac_addreses)
 {
-	unsigned int i = 0;
+	unsigned int i = 0, j;
 	struct range_t *range_p;
-	struct shared_network_t *shared_p;
 	struct output_helper_t oh;
 	FILE *outfile;
 	unsigned int sep;
@@ -488,16 +663,44 @@ static int output_json(struct conf_t *state, const int print_mac_addreses)
 		sep++;
 	}
 
+	if (state->duplicates) {
+		struct macs_t *m;
+		struct leases_t *l;
+
+		if (sep) {
+			fprintf(outfile, ",\n");
+		}
+		fprintf(outfile, "   \"duplicate_clients\": [");
+		i = 0;
+		for (m = state->macs; m != NULL; m = m->hh.next) {
+			if (m->count < 2)
+				continue;
+			if (i == 0)
+				i = 1;
+			else
+				fputc(',', outfile);
+			fprintf(outfile, "\n         { \"macaddress\":\"%s\", ", ntop_mac(m->mac));
+			fprintf(outfile, "\"leases\":%u, \"ranges\":%u, \"ips\":[", m->count, m->ranges);
+			for (l = m->leases; l != NULL; l = l->mac_next)
+				fprintf(outfile, "\"%s\"%s", ntop_ipaddr(&l->ip), l->mac_next ? "," : "");
+			fputs("] }", outfile);
+		}
+		fprintf(outfile, "\n   ]");	/* end of duplicate_clients */
+		sep++;
+	}
+
 	if (state->number_limit & R_BIT) {
 		if (sep) {
 			fprintf(outfile, ",\n");
 		}
 		fprintf(outfile, "   \"subnets\": [\n");
-		for (i = 0; i < state->num_ranges; i++) {
-			if (range_output_helper(state, &oh, range_p)) {
+		for (i = 0, j = 0; i < state->num_ranges; i++) {
+			if (range_output_helper(state, &oh, range_p) || range_p->unchanged) {
 				range_p++;
 				continue;
 			}
+			if (j++)
+				fprintf(outfile, ",\n");
 			fprintf(outfile, "         ");
 			fprintf(outfile, "{ ");
 			if (range_p->shared_net) {
@@ -511,6 +714,9 @@ static int output_json(struct conf_t *state, const int print_mac_addreses)
 			fprintf(outfile, " - %s\", ", ntop_ipaddr(&range_p->last_ip));
 			fprintf(outfile, "\"first_ip\":\"%s\", ", ntop_ipaddr(&range_p->first_ip));
 			fprintf(outfile, "\"last_ip\":\"%s\", ", ntop_ipaddr(&range_p->last_ip));
+			/* prefix6 ranges count delegated prefixes */
+			if (range_p->prefix_len)
+				fprintf(outfile, "\"prefix_length\":%d, ", range_p->prefix_len);
 			fprintf(outfile, "\"defined\":%g, ", oh.range_size);
 			fprintf(outfile, "\"used\":%g, ", range_p->count);
 			fprintf(outfile, "\"touched\":%g, ", range_p->touched);
@@ -522,14 +728,20 @@ static int output_json(struct conf_t *state, const int print_mac_addreses)
 				fprintf(outfile, "\"backup_count\":%g, ", range_p->backups);
 				fprintf(outfile, "\"backup_percent\":%g, ", oh.bup);
 			}
-			fprintf(outfile, "\"status\":%d ", oh.status);
-
+			if (state->lease_histogram) {
+				fprintf(outfile, "\"lease_time_histogram\":[");
+				output_lease_hist(outfile, range_p->lease_hist);
+				fprintf(outfile, "], ");
+			}
+			if (state->forecast_file)
+				json_forecast(outfile, range_p->growth_rate, range_p->eta, "", " ");
+			if (range_p->bitmap)
+				json_fragmentation(outfile, range_p->bitmap);
+			fprintf(outfile, "\"status\":%d }", oh.status);
 			range_p++;
-			if (i + 1 < state->num_ranges)
-				fprintf(outfile, "},\n");
-			else
-				fprintf(outfile, "}\n");
 		}
+		if (j)
+			fprintf(outfile, "\n");
 		fprintf(outfile, "   ]");	/* end of subnets */
 		sep++;
 	}
@@ -538,40 +750,21 @@ static int output_json(struct conf_t *state, const int print_mac_addreses)
 		if (sep) {
 			fprintf(outfile, ",\n");
 		}
-		fprintf(outfile, "   \"shared-networks\": [\n");
-		for (shared_p = state->shared_net_root->next; shared_p; shared_p = shared_p->next) {
-			if (shnet_output_helper(state, &oh, shared_p))
-				continue;
-			fprintf(outfile, "         ");
-			fprintf(outfile, "{ ");
-			fprintf(outfile, "\"location\":\"%s\", ", shared_p->name);
-			fprintf(outfile, "\"defined\":%g, ", shared_p->available);
-			fprintf(outfile, "\"used\":%g, ", shared_p->used);
-			fprintf(outfile, "\"touched\":%g, ", shared_p->touched);
-			fprintf(outfile, "\"free\":%g, ", shared_p->available - shared_p->used);
-			if (fpclassify(shared_p->available) == FP_ZERO)
-				fprintf(outfile, "\"percent\":\"%g\", ", oh.percent);
-			else
-				fprintf(outfile, "\"percent\":%g, ", oh.percent);
-			fprintf(outfile, "\"touch_count\":%g, ", oh.tc);
-			if (fpclassify(shared_p->available) == FP_ZERO)
-				fprintf(outfile, "\"touch_percent\":\"%g\", ", oh.tcp);
-			else
-				fprintf(outfile, "\"touch_percent\":%g, ", oh.tcp);
-			if (state->backups_found == 1) {
-				fprintf(outfile, "\"backup_count\":%g, ", shared_p->backups);
-				if (fpclassify(shared_p->available) == FP_ZERO)
-					fprintf(outfile, "\"backup_percent\":\"%g\", ", oh.bup);
-				else
-					fprintf(outfile, "\"backup_percent\":%g, ", oh.bup);
-			}
-			fprintf(outfile, "\"status\":%d ", oh.status);
-			if (shared_p->next)
-				fprintf(outfile, "},\n");
-			else
-				fprintf(outfile, "}\n");
+		json_shnet_list(state, outfile, "shared-networks", state->shared_net_root->next, 1);
+		sep++;
+		if (state->pool_counting) {
+			fprintf(outfile, ",\n");
+			json_shnet_list(state, outfile, "pools", state->pools, 0);
+			fprintf(outfile, ",\n");
+			json_shnet_list(state, outfile, "classes", state->classes, 0);
 		}
-		fprintf(outfile, "   ]");	/* end of shared-networks */
+	}
+
+	if (state->changed_file) {
+		if (sep) {
+			fprintf(outfile, ",\n");
+		}
+		json_tombstones(state, outfile);
 		sep++;
 	}
 
@@ -595,6 +788,26 @@ static int output_json(struct conf_t *state, const int print_mac_addreses)
 				state->shared_net_root->backups);
 			fprintf(outfile, "         \"backup_percent\":%g,\n", oh.bup);
 		}
+		if (state->lease_histogram) {
+			fprintf(outfile, "         \"lease_time_histogram\":[");
+			output_lease_hist(outfile, state->shared_net_root->lease_hist);
+			fprintf(outfile, "],\n");
+		}
+		if (state->forecast_file)
+			json_forecast(outfile, state->shared_net_root->growth_rate,
+				      state->shared_net_root->eta, "         ", "\n");
+		if (state->duplicates) {
+			fprintf(outfile, "         \"duplicate_clients_across_ranges\":%u,\n",
+				state->dup_across_ranges);
+			fprintf(outfile, "         \"duplicate_clients_in_range\":%u,\n",
+				state->dup_in_range);
+		}
+		if (state->overlap_ranges) {
+			fprintf(outfile, "         \"overlapping_ranges\":%u,\n",
+				state->overlap_ranges);
+			fprintf(outfile, "         \"overlapping_addresses\":%g,\n",
+				state->overlap_addresses);
+		}
 		fprintf(outfile, "         \"status\":%d\n", oh.status);
 		fprintf(outfile, "   },\n");	/* end of summary */
 		fprintf(outfile, "   \"trivia\": {\n");
@@ -606,6 +819,15 @@ static int output_json(struct conf_t *state, const int print_mac_addreses)
 		fprintf(outfile, "         \"lease_file_path\":\"%s\",\n", state->dhcpdlease_file);
 		fprintf(outfile, "         \"lease_file_epoch_mtime\":");
 		dp_time_tool(outfile, state->dhcpdlease_file, 1);
+		if (state->lease_histogram) {
+			fprintf(outfile, ",\n         \"lease_time_buckets\":[");
+			output_lease_hist_bounds(outfile);
+			fprintf(outfile, "]");
+		}
+		if (state->print_stats) {
+			fprintf(outfile, ",\n");
+			stats_print(state, outfile, 1);
+		}
 		fprintf(outfile, "\n");
 
 		fprintf(outfile, "   }");	/* end of trivia */
@@ -759,12 +981,67 @@ static void newsection(FILE *restrict f, char const *restrict title)
 	output_line(f, "h3", title);
 }
 
+/*! \brief Print shared networks, pools, or classes as a html table.
+ * \param title Section title.
+ * \param id Table id.
+ * \param summary Table summary.
+ * \param list First entry of a linked list. */
+static void html_shnet_table(struct conf_t *state, FILE *outfile, const char *title,
+			     const char *id, const char *summary, struct shared_network_t *list)
+{
+	struct shared_network_t *shared_p;
+	struct output_helper_t oh;
+
+	newsection(outfile, title);
+	table_start(outfile, id, summary);
+	if (state->header_limit & S_BIT) {
+		start_tag(outfile, "thead");
+		start_tag(outfile, "tr");
+		output_line(outfile, "th", "名称");
+		output_line(outfile, "th", "总数");
+		output_line(outfile, "th", "在用");
+		output_line(outfile, "th", "空闲");
+		output_line(outfile, "th", "比例");
+		output_line(outfile, "th", "曾用");
+		output_line(outfile, "th", "在用+曾用");
+		output_line(outfile, "th", "在用+曾用比例");
+		if (state->backups_found == 1) {
+			output_line(outfile, "th", "bu");
+			output_line(outfile, "th", "bu perc");
+		}
+		end_tag(outfile, "tr");
+		end_tag(outfile, "thead");
+	}
+	if (state->number_limit & S_BIT) {
+		start_tag(outfile, "tbody");
+		for (shared_p = list; shared_p; shared_p = shared_p->next) {
+			if (shnet_output_helper(state, &oh, shared_p))
+				continue;
+			start_tag(outfile, "tr");
+			output_line(outfile, "td", shared_p->name);
+			output_double(outfile, "td", shared_p->available);
+			output_double(outfile, "td", shared_p->used);
+			output_double(outfile, "td", shared_p->available - shared_p->used);
+			output_double_color(state, &oh, outfile, "td");
+			output_double(outfile, "td", shared_p->touched);
+			output_double(outfile, "td", oh.tc);
+			output_float(outfile, "td", oh.tcp);
+			if (state->backups_found == 1) {
+				output_double(outfile, "td", shared_p->backups);
+				output_float(outfile, "td", oh.bup);
+			}
+			end_tag(outfile, "tr");
+		}
+		end_tag(outfile, "tbody");
+	}
+	table_end(outfile);
+}
+
 /*! \brief Output html format. */
 static int output_html(struct conf_t *state)
 {
 	unsigned int i;
 	struct range_t *range_p;
-	struct shared_network_t *shared_p;
 	struct output_helper_t oh;
 	FILE *outfile;
 
@@ -811,49 +1088,11 @@ static int output_html(struct conf_t *state)
 		end_tag(outfile, "tbody");
 	}
 	table_end(outfile);
-	newsection(outfile, "多地址段网络");
-	table_start(outfile, "s", "snet");
-	if (state->header_limit & S_BIT) {
-		start_tag(outfile, "thead");
-		start_tag(outfile, "tr");
-		output_line(outfile, "th", "名称");
-		output_line(outfile, "th", "总数");
-		output_line(outfile, "th", "在用");
-		output_line(outfile, "th", "空闲");
-		output_line(outfile, "th", "比例");
-		output_line(outfile, "th", "曾用");
-		output_line(outfile, "th", "在用+曾用");
-		output_line(outfile, "th", "在用+曾用比例");
-		if (state->backups_found == 1) {
-			output_line(outfile, "th", "bu");
-			output_line(outfile, "th", "bu perc");
-		}
-		end_tag(outfile, "tr");
-		end_tag(outfile, "thead");
+	html_shnet_table(state, outfile, "多地址段网络", "s", "snet", state->shared_net_root->next);
+	if (state->pool_counting) {
+		html_shnet_table(state, outfile, "地址池", "p", "pools", state->pools);
+		html_shnet_table(state, outfile, "客户端类别", "c", "classes", state->classes);
 	}
-	if (state->number_limit & S_BIT) {
-		start_tag(outfile, "tbody");
-		for (shared_p = state->shared_net_root->next; shared_p; shared_p = shared_p->next) {
-			if (shnet_output_helper(state, &oh, shared_p))
-				continue;
-			start_tag(outfile, "tr");
-			output_line(outfile, "td", shared_p->name);
-			output_double(outfile, "td", shared_p->available);
-			output_double(outfile, "td", shared_p->used);
-			output_double(outfile, "td", shared_p->available - shared_p->used);
-			output_double_color(state, &oh, outfile, "td");
-			output_double(outfile, "td", shared_p->touched);
-			output_double(outfile, "td", oh.tc);
-			output_float(outfile, "td", oh.tcp);
-			if (state->backups_found == 1) {
-				output_double(outfile, "td", shared_p->backups);
-				output_float(outfile, "td", oh.bup);
-			}
-			end_tag(outfile, "tr");
-		}
-		end_tag(outfile, "tbody");
-	}
-	table_end(outfile);
 	newsection(outfile, "地址段");
 	table_start(outfile, "r", "ranges");
 	if (state->header_limit & R_BIT) {
@@ -913,12 +1152,70 @@ static int output_html(struct conf_t *state)
 	return 0;
 }
 
+/*! \brief Print shared networks, pools, or classes in csv format.
+ * \param title Section title.
+ * \param list First entry of a linked list. */
+static void csv_shnet_list(struct conf_t *state, FILE *outfile, const char *title,
+			   struct shared_network_t *list)
+{
+	struct shared_network_t *shared_p;
+	struct output_helper_t oh;
+
+	if (state->header_limit & S_BIT) {
+		fprintf(outfile, "\"%s\"\n", title);
+		fprintf(outfile,
+			"\"name\",\"max\",\"cur\",\"percent\",\"touch\",\"t+c\",\"t+c perc\"");
+		if (state->backups_found == 1) {
+			fprintf(outfile, ",\"bu\",\"bu perc\"");
+		}
+		fprintf(outfile, "\n");
+	}
+	if (state->number_limit & S_BIT) {
+		for (shared_p = list; shared_p; shared_p = shared_p->next) {
+			if (shnet_output_helper(state, &oh, shared_p) || shared_p->unchanged)
+				continue;
+			fprintf(outfile,
+				"\"%s\",\"%g\",\"%g\",\"%.3f\",\"%g\",\"%g\",\"%.3f\"",
+				shared_p->name,
+				shared_p->available,
+				shared_p->used,
+				oh.percent,
+				shared_p->touched,
+				oh.tc,
+				oh.tcp);
+			if (state->backups_found == 1) {
+				fprintf(outfile, ",\"%g\",\"%.3f\"", shared_p->backups, oh.bup);
+			}
+
+			fprintf(outfile, "\n");
+		}
+		fprintf(outfile, "\n");
+	}
+}
+
+/*! \brief Print tombstones of --changed-only mode in csv format. */
+static void csv_tombstones(struct conf_t *state, FILE *outfile)
+{
+	struct tombstone_t *t;
+	unsigned int i;
+
+	fprintf(outfile, "\"Removed:\"\n");
+	fprintf(outfile, "\"type\",\"name\",\"first ip\",\"last ip\"\n");
+	for (i = 0, t = state->tombstones; i < state->num_tombstones; i++, t++) {
+		if (t->is_range) {
+			fprintf(outfile, "\"range\",\"\",\"%s\",", ntop_ipaddr(&t->first_ip));
+			fprintf(outfile, "\"%s\"\n", ntop_ipaddr(&t->last_ip));
+		} else
+			fprintf(outfile, "\"shared-network\",\"%s\",\"\",\"\"\n", t->name);
+	}
+	fprintf(outfile, "\n");
+}
+
 /*! \brief Output cvs format. */
 static int output_csv(struct conf_t *state)
 {
 	unsigned int i;
 	struct range_t *range_p;
-	struct shared_network_t *shared_p;
 	struct output_helper_t oh;
 	FILE *outfile;
 
@@ -936,7 +1233,7 @@ static int output_csv(struct conf_t *state)
 	}
 	if (state->number_limit & R_BIT) {
 		for (i = 0; i < state->num_ranges; i++) {
-			if (range_output_helper(state, &oh, range_p)) {
+			if (range_output_helper(state, &oh, range_p) || range_p->unchanged) {
 				range_p++;
 				continue;
 			}
@@ -964,37 +1261,13 @@ static int output_csv(struct conf_t *state)
 		}
 		fprintf(outfile, "\n");
 	}
-	if (state->header_limit & S_BIT) {
-		fprintf(outfile, "\"Shared networks:\"\n");
-		fprintf(outfile,
-			"\"name\",\"max\",\"cur\",\"percent\",\"touch\",\"t+c\",\"t+c perc\"");
-		if (state->backups_found == 1) {
-			fprintf(outfile, ",\"bu\",\"bu perc\"");
-		}
-		fprintf(outfile, "\n");
-	}
-	if (state->number_limit & S_BIT) {
-
-		for (shared_p = state->shared_net_root->next; shared_p; shared_p = shared_p->next) {
-			if (shnet_output_helper(state, &oh, shared_p))
-				continue;
-			fprintf(outfile,
-				"\"%s\",\"%g\",\"%g\",\"%.3f\",\"%g\",\"%g\",\"%.3f\"",
-				shared_p->name,
-				shared_p->available,
-				shared_p->used,
-				oh.percent,
-				shared_p->touched,
-				oh.tc,
-				oh.tcp);
-			if (state->backups_found == 1) {
-				fprintf(outfile, ",\"%g\",\"%.3f\"", shared_p->backups, oh.bup);
-			}
-
-			fprintf(outfile, "\n");
-		}
-		fprintf(outfile, "\n");
+	csv_shnet_list(state, outfile, "Shared networks:", state->shared_net_root->next);
+	if (state->pool_counting) {
+		csv_shnet_list(state, outfile, "Pools:", state->pools);
+		csv_shnet_list(state, outfile, "Classes:", state->classes);
 	}
+	if (state->changed_file)
+		csv_tombstones(state, outfile);
 	if (state->header_limit & A_BIT) {
 		fprintf(outfile, "\"Sum of all ranges:\"\n");
 		fprintf(outfile,
@@ -1024,6 +1297,265 @@ static int output_csv(struct conf_t *state)
 	return 0;
 }
 
+/*! \struct munin_item
+ * \brief A field of munin graph. */
+struct munin_item {
+	char *field;		/*!< Sanitized field name. */
+	char *label;		/*!< Human readable name. */
+	double used;		/*!< Used addresses. */
+	double percent;		/*!< Used percent. */
+};
+
+/*! \brief Make munin field name, that must start with a letter or
+ * underscore, and have only letters, digits, and underscores.
+ * \return Allocated field name. */
+static char *munin_field(const char prefix, const char *name)
+{
+	char *field = xmalloc(strlen(name) + 3), *p;
+
+	field[0] = prefix;
+	field[1] = '_';
+	strcpy(field + 2, name);
+	for (p = field + 2; *p; p++)
+		if (!isalnum((unsigned char)*p))
+			*p = '_';
+	return field;
+}
+
+/*! \brief Print a munin multigraph with config and values.
+ * \param id Graph name suffix.
+ * \param what Name of the items in graph title.
+ * \param percent Graph used percent instead of used addresses. */
+static void munin_graph(struct conf_t *state, FILE *f, const char *id, const char *what,
+			const struct munin_item *items, unsigned int n, const int percent)
+{
+	unsigned int i;
+
+	fprintf(f, "multigraph dhcpd_pools_%s%s\n", id, percent ? "_percent" : "");
+	fprintf(f, "graph_title dhcpd %s usage%s\n", what, percent ? " (in percent)" : "");
+	if (percent) {
+		fprintf(f, "graph_args --upper-limit 100 -l 0 --rigid\n");
+		fprintf(f, "graph_vlabel %%\n");
+		fprintf(f, "graph_scale no\n");
+	} else {
+		fprintf(f, "graph_args -l 0\n");
+		fprintf(f, "graph_vlabel leases\n");
+	}
+	fprintf(f, "graph_category network\n");
+	for (i = 0; i < n; i++) {
+		fprintf(f, "%s.label %s\n", items[i].field, items[i].label);
+		if (percent) {
+			fprintf(f, "%s.warning %g\n", items[i].field, state->warning);
+			fprintf(f, "%s.critical %g\n", items[i].field, state->critical);
+			fprintf(f, "%s.value %.3f\n", items[i].field, items[i].percent);
+		} else
+			fprintf(f, "%s.value %g\n", items[i].field, items[i].used);
+	}
+	fprintf(f, "\n");
+}
+
+/*! \brief Output munin multigraph format.  Config and values are printed
+ * together, that munin calls dirtyconfig, so that a plugin can answer
+ * both config and fetch requests from a single run.  Field names are
+ * sanitized once, and used in both absolute and percent graphs. */
+static int output_munin(struct conf_t *state)
+{
+	struct munin_item *items;
+	struct shared_network_t *shared_p;
+	struct range_t *range_p;
+	struct output_helper_t oh;
+	unsigned int i, j, n = 0;
+	FILE *outfile;
+	const char *name;
+	char buf[sizeof("_4294967295")];
+
+	outfile = open_outfile(state);
+	if (state->number_limit & R_BIT) {
+		items = xmalloc(sizeof(struct munin_item) * (state->num_ranges + 1));
+		for (i = 0, range_p = state->ranges; i < state->num_ranges; i++, range_p++) {
+			range_output_helper(state, &oh, range_p);
+			items[i].field = munin_field('r', ntop_ipaddr(&range_p->first_ip));
+			name = range_p->shared_net ? range_p->shared_net->name : "not_defined";
+			items[i].label = xmalloc(strlen(name) + 2 * 40 + 5);
+			sprintf(items[i].label, "%s %s - ", name, ntop_ipaddr(&range_p->first_ip));
+			strcat(items[i].label, ntop_ipaddr(&range_p->last_ip));
+			items[i].used = range_p->count;
+			items[i].percent = oh.percent;
+		}
+		munin_graph(state, outfile, "ranges", "range", items, state->num_ranges, 0);
+		munin_graph(state, outfile, "ranges", "range", items, state->num_ranges, 1);
+		for (i = 0; i < state->num_ranges; i++) {
+			free(items[i].field);
+			free(items[i].label);
+		}
+		free(items);
+	}
+	if (state->number_limit & (S_BIT | A_BIT)) {
+		for (shared_p = state->shared_net_root->next; shared_p; shared_p = shared_p->next)
+			n++;
+		items = xmalloc(sizeof(struct munin_item) * (n + 1));
+		n = 0;
+		for (shared_p = state->shared_net_root; shared_p; shared_p = shared_p->next) {
+			if (shared_p == state->shared_net_root ? !(state->number_limit & A_BIT)
+			    : !(state->number_limit & S_BIT))
+				continue;
+			shnet_output_helper(state, &oh, shared_p);
+			if (shared_p == state->shared_net_root)
+				items[n].field = xstrdup("all");
+			else
+				items[n].field = munin_field('s', shared_p->name);
+			/* names that differ only by special characters */
+			for (j = 0; j < n; j++) {
+				if (strcmp(items[j].field, items[n].field))
+					continue;
+				snprintf(buf, sizeof(buf), "_%u", n);
+				items[n].field = xrealloc(items[n].field,
+							  strlen(items[n].field) + sizeof(buf));
+				strcat(items[n].field, buf);
+				break;
+			}
+			items[n].label = xstrdup(shared_p->name);
+			items[n].used = shared_p->used;
+			items[n].percent = oh.percent;
+			n++;
+		}
+		munin_graph(state, outfile, "shared_networks", "shared network", items, n, 0);
+		munin_graph(state, outfile, "shared_networks", "shared network", items, n, 1);
+		for (i = 0; i < n; i++) {
+			free(items[i].field);
+			free(items[i].label);
+		}
+		free(items);
+	}
+	close_outfile(outfile);
+	return 0;
+}
+
+/*! \brief Print prometheus label value with escapes. */
+static void prometheus_label(FILE *f, const char *s)
+{
+	for (; *s; s++) {
+		if (*s == '\\' || *s == '"')
+			fputc('\\', f);
+		if (*s == '\n') {
+			fputs("\\n", f);
+			continue;
+		}
+		fputc(*s, f);
+	}
+}
+
+/*! \brief Print prometheus samples of a shared network or summary. */
+static void prometheus_shnet(FILE *f, const char *metric, struct output_helper_t *oh,
+			     struct shared_network_t *shared_p)
+{
+	const char *names[] = { "defined", "used", "touched", "free", "touch_count", "status" };
+	double values[] = { shared_p->available, shared_p->used, shared_p->touched,
+		shared_p->available - shared_p->used, oh->tc, oh->status };
+	unsigned int i;
+
+	for (i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+		fprintf(f, "%s{location=\"", metric);
+		prometheus_label(f, shared_p->name);
+		fprintf(f, "\",%s=\"1\"} %g\n", names[i], values[i]);
+	}
+}
+
+/*! \brief Output prometheus text exposition format.  Metric and label
+ * names are the same as in samples/prometheus.template, but samples do not
+ * have time stamps. */
+static int output_prometheus(struct conf_t *state)
+{
+	const char *names[] = { "used", "touched", "defined", "free", "touch_count", "status" };
+	struct shared_network_t *shared_p;
+	struct range_t *range_p;
+	struct output_helper_t oh;
+	unsigned int i, j;
+	FILE *outfile;
+
+	outfile = open_outfile(state);
+	if (state->number_limit & R_BIT) {
+		fprintf(outfile, "# HELP dhcpd_pools_ranges The range statistics.\n");
+		fprintf(outfile, "# TYPE dhcpd_pools_ranges gauge\n");
+		for (i = 0, range_p = state->ranges; i < state->num_ranges; i++, range_p++) {
+			double values[] = { range_p->count, range_p->touched, 0, 0, 0, 0 };
+
+			if (range_output_helper(state, &oh, range_p))
+				continue;
+			values[2] = oh.range_size;
+			values[3] = oh.range_size - range_p->count;
+			values[4] = oh.tc;
+			values[5] = oh.status;
+			for (j = 0; j < sizeof(names) / sizeof(names[0]); j++)
+				fprintf(outfile, "dhcpd_pools_ranges{range=\"%s\",%s=\"1\"} %g\n",
+					ntop_ipaddr(&range_p->first_ip), names[j], values[j]);
+		}
+	}
+	if (state->number_limit & S_BIT) {
+		fprintf(outfile, "# HELP dhcpd_pools_shared_nets The shared networks statistics.\n");
+		fprintf(outfile, "# TYPE dhcpd_pools_shared_nets gauge\n");
+		for (shared_p = state->shared_net_root->next; shared_p; shared_p = shared_p->next) {
+			if (shnet_output_helper(state, &oh, shared_p))
+				continue;
+			prometheus_shnet(outfile, "dhcpd_pools_shared_nets", &oh, shared_p);
+		}
+	}
+	if (state->number_limit & A_BIT) {
+		fprintf(outfile, "# HELP dhcpd_pools_summary Statistics of the all networks.\n");
+		fprintf(outfile, "# TYPE dhcpd_pools_summary gauge\n");
+		shnet_output_helper(state, &oh, state->shared_net_root);
+		prometheus_shnet(outfile, "dhcpd_pools_summary", &oh, state->shared_net_root);
+	}
+	close_outfile(outfile);
+	return 0;
+}
+
+/*! \brief Count alarm states of shared networks, pools, or classes.
+ * \param list First entry of a linked list.
+ * \param c,w,o,i Critical, warning, ok, and ignored counters. */
+static void alarm_count(struct conf_t *state, struct shared_network_t *list,
+			int *c, int *w, int *o, int *i)
+{
+	struct shared_network_t *shared_p;
+	struct output_helper_t oh;
+
+	for (shared_p = list; shared_p; shared_p = shared_p->next) {
+		shnet_output_helper(state, &oh, shared_p);
+		switch (oh.status) {
+		case STATUS_SUPPRESSED:
+			break;
+		case STATUS_IGNORED:
+			(*i)++;
+			break;
+		case STATUS_CRIT:
+			(*c)++;
+			break;
+		case STATUS_WARN:
+			(*w)++;
+			break;
+		case STATUS_OK:
+			(*o)++;
+			break;
+		default:
+			abort();
+		}
+	}
+}
+
+/*! \brief Print alarm counts of pools or classes.
+ * \param title Human readable name.
+ * \param prefix Performance data name prefix. */
+static void alarm_line(FILE *outfile, const char *title, const char *prefix,
+		       int c, int w, int o, int i)
+{
+	fprintf(outfile, "%s - crit: %d warn: %d ok: %d", title, c, w, o);
+	if (i != 0)
+		fprintf(outfile, " ignored: %d", i);
+	fprintf(outfile, "; | %s_crit=%d %s_warn=%d %s_ok=%d", prefix, c, prefix, w, prefix, o);
+	if (i != 0)
+		fprintf(outfile, " %s_ignored=%d", prefix, i);
+}
+
 /*! \brief Output alarm text, and return program exit value. */
 static int output_alarming(struct conf_t *state)
 {
@@ -1033,6 +1565,7 @@ static int output_alarming(struct conf_t *state)
 	struct output_helper_t oh;
 	unsigned int i;
 	int rw = 0, rc = 0, ro = 0, ri = 0, sw = 0, sc = 0, so = 0, si = 0;
+	int pw = 0, pc = 0, po = 0, pi = 0, cw = 0, cc = 0, co = 0, ci = 0;
 	int ret_val;
 
 	outfile = open_outfile(state);
@@ -1063,41 +1596,25 @@ static int output_alarming(struct conf_t *state)
 		}
 	}
 	if (state->number_limit & S_BIT) {
-		for (shared_p = state->shared_net_root->next; shared_p; shared_p = shared_p->next) {
-			shnet_output_helper(state, &oh, shared_p);
-			switch (oh.status) {
-			case STATUS_SUPPRESSED:
-				break;
-			case STATUS_IGNORED:
-				si++;
-				break;
-			case STATUS_CRIT:
-				sc++;
-				break;
-			case STATUS_WARN:
-				sw++;
-				break;
-			case STATUS_OK:
-				so++;
-				break;
-			default:
-				abort();
-			}
+		alarm_count(state, state->shared_net_root->next, &sc, &sw, &so, &si);
+		if (state->pool_counting) {
+			alarm_count(state, state->pools, &pc, &pw, &po, &pi);
+			alarm_count(state, state->classes, &cc, &cw, &co, &ci);
 		}
 	}
 
-	if (sc || rc)
+	if (sc || rc || pc || cc)
 		ret_val = STATE_CRITICAL;
-	else if (sw || rw)
+	else if (sw || rw || pw || cw)
 		ret_val = STATE_WARNING;
 	else
 		ret_val = STATE_OK;
 
 	if ((0 < rc && state->number_limit & R_BIT)
-	    || (0 < sc && state->number_limit & S_BIT)) {
+	    || (0 < sc + pc + cc && state->number_limit & S_BIT)) {
 		fprintf(outfile, "CRITICAL: %s:", program_name);
 	} else if ((0 < rw && state->number_limit & R_BIT)
-		   || (0 < sw && state->number_limit & S_BIT)) {
+		   || (0 < sw + pw + cw && state->number_limit & S_BIT)) {
 		fprintf(outfile, "WARNING: %s:", program_name);
 	} else {
 		if (state->number_limit & A_BIT)
@@ -1174,6 +1691,13 @@ static int output_alarming(struct conf_t *state)
 			fprintf(outfile, "\n");
 		}
 	}
+	if (state->pool_counting && state->header_limit & S_BIT) {
+		if (!(state->perfdata == 1 && state->header_limit & R_BIT))
+			fprintf(outfile, "\n");
+		alarm_line(outfile, "Pools", "pool", pc, pw, po, pi);
+		fprintf(outfile, "\n");
+		alarm_line(outfile, "Classes", "class", cc, cw, co, ci);
+	}
 	fprintf(outfile, "\n");
 	close_outfile(outfile);
 	return ret_val;
@@ -1214,6 +1738,12 @@ int output_analysis(struct conf_t *state, const char output_format)
 	case 'c':
 		ret = output_csv(state);
 		break;
+	case 'M':
+		ret = output_munin(state);
+		break;
+	case 'P':
+		ret = output_prometheus(state);
+		break;
 #ifdef BUILD_MUSTACH
 	case 'm':
 		ret = mustach_dhcpd_pools(state);
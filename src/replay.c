@@ -0,0 +1,208 @@
+/*
+ * The dhcpd-pools has BSD 2-clause license which also known as "Simplified
+ * BSD License" or "FreeBSD License".
+ *
+ * Copyright 2006- Sami Kerola. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the
+ *       distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR AND CONTRIBUTORS OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing
+ * official policies, either expressed or implied, of Sami Kerola.
+ */
+
+
+/*! \file replay.c
+ * \brief Usage timeline reconstructed from a single dhcpd.leases file.
+ *
+ * The dhcpd.leases file is a journal where a later record of an address
+ * overrides earlier ones.  Replay follows the records in file order, keeps
+ * range counters up to date as every binding state is applied, and prints
+ * the counters of all ranges whenever the journal time crosses a bucket
+ * boundary.  Journal time is the largest client last transaction time, or
+ * starts time when cltt is missing, seen so far, so records that dhcpd
+ * rewrote out of time order are accounted to the current bucket.  The
+ * lease hash is the only state that grows, so memory use is bounded by
+ * the number of distinct addresses.
+ */
+
+#include <config.h>
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "close-stream.h"
+#include "error.h"
+
+#include "dhcpd-pools.h"
+
+/*! \brief Print counters of all ranges at end of the current bucket. */
+static void replay_output(struct conf_t *state)
+{
+	FILE *f = state->replay_stream;
+	struct range_t *r;
+	unsigned int i;
+	double size;
+
+	for (i = 0, r = state->ranges; i < state->num_ranges; i++, r++) {
+		size = get_range_size(r);
+		switch (state->replay_format) {
+		case 't':
+			dp_time_print(f, state->replay_bucket, 0);
+			fprintf(f, " %-20s %-15s", r->shared_net->name, ntop_ipaddr(&r->first_ip));
+			fprintf(f, " - %-15s %5g %5g %10.3f %7g %6g\n", ntop_ipaddr(&r->last_ip),
+				size, r->count, 100 * r->count / size, r->touched, r->backups);
+			break;
+		case 'c':
+			fprintf(f, "\"%ld\",\"%s\",", (long)state->replay_bucket, r->shared_net->name);
+			fprintf(f, "\"%s\",", ntop_ipaddr(&r->first_ip));
+			fprintf(f, "\"%s\",\"%g\",\"%g\",\"%.3f\",\"%g\",\"%g\"\n",
+				ntop_ipaddr(&r->last_ip), size, r->count, 100 * r->count / size,
+				r->touched, r->backups);
+			break;
+		case 'j':
+			fprintf(f, "%s         { \"time\":%ld, \"location\":\"%s\", ",
+				state->replay_rows ? ",\n" : "", (long)state->replay_bucket,
+				r->shared_net->name);
+			fprintf(f, "\"first_ip\":\"%s\", ", ntop_ipaddr(&r->first_ip));
+			fprintf(f, "\"last_ip\":\"%s\", ", ntop_ipaddr(&r->last_ip));
+			fprintf(f, "\"defined\":%g, \"used\":%g, \"touched\":%g, \"free\":%g, "
+				"\"percent\":%g, \"backup_count\":%g }", size, r->count, r->touched,
+				size - r->count, 100 * r->count / size, r->backups);
+			break;
+		}
+		state->replay_rows++;
+	}
+}
+
+/*! \brief Move journal time forward, and print every bucket that ends
+ * before the time. */
+static void replay_advance(struct conf_t *state, int64_t t)
+{
+	if (state->replay_bucket == 0) {
+		/* the first time stamp opens the first bucket */
+		state->replay_bucket = t - t % state->replay_interval + state->replay_interval;
+		return;
+	}
+	while (state->replay_bucket <= t) {
+		replay_output(state);
+		state->replay_bucket += state->replay_interval;
+	}
+}
+
+/*! \brief Apply a lease binding state change to range counters.
+ * \param prev Previous lease type of the address, or -1 when address was
+ * not seen before.
+ * \param t Time stamp of the lease record, zero when not known. */
+void replay_lease(struct conf_t *state, const union ipaddr_t *addr, int prev,
+		  enum ltype type, int64_t t)
+{
+	struct range_t *r;
+
+	if (0 < t)
+		replay_advance(state, t);
+	r = find_range(state, addr);
+	if (r == NULL)
+		return;
+	switch (prev) {
+	case ACTIVE:
+		r->count--;
+		break;
+	case FREE:
+		r->touched--;
+		break;
+	case BACKUP:
+		r->backups--;
+		break;
+	}
+	switch (type) {
+	case ACTIVE:
+		r->count++;
+		break;
+	case FREE:
+		r->touched++;
+		break;
+	case BACKUP:
+		r->backups++;
+		break;
+	}
+}
+
+/*! \brief Print range usage at fixed time buckets over the lifetime of
+ * the lease file, instead of analysing the final state.
+ * \return Exit value of the command. */
+int replay_run(struct conf_t *state, const char output_format)
+{
+	switch (output_format) {
+	case 't':
+	case 'c':
+	case 'j':
+		break;
+	case 'J':
+		return replay_run(state, 'j');
+	default:
+		error(EXIT_FAILURE, 0, "replay_run: unsupported output format: '%c'",
+		      output_format);
+	}
+	if (1 < state->num_lease_files)
+		error(EXIT_FAILURE, 0, "--replay requires a single lease file");
+	parse_config(state, 1, state->dhcpdconf_file, state->shared_net_root);
+	/* ranges must be sorted to find them, the lease hash is still empty */
+	prepare_data(state);
+	state->replay_format = output_format;
+	if (state->output_file) {
+		state->replay_stream = fopen(state->output_file, "w+");
+		if (state->replay_stream == NULL)
+			error(EXIT_FAILURE, errno, "replay_run: %s", state->output_file);
+	} else
+		state->replay_stream = stdout;
+	switch (output_format) {
+	case 't':
+		fprintf(state->replay_stream, "time                     shared net name      "
+			"first ip          last ip           max   cur    percent  touch     bu\n");
+		break;
+	case 'c':
+		fprintf(state->replay_stream, "\"time\",\"shared net name\",\"first ip\","
+			"\"last ip\",\"max\",\"cur\",\"percent\",\"touch\",\"bu\"\n");
+		break;
+	case 'j':
+		fprintf(state->replay_stream, "{\n   \"replay\": [\n");
+		break;
+	}
+	parse_leases(state, 0);
+	/* the last bucket is partial, and printed with its end time */
+	if (state->replay_bucket)
+		replay_output(state);
+	if (output_format == 'j')
+		fprintf(state->replay_stream, "\n   ]\n}\n");
+	if (state->replay_stream == stdout) {
+		if (fflush(stdout))
+			error(EXIT_FAILURE, errno, "replay_run: fflush");
+	} else if (close_stream(state->replay_stream))
+		error(EXIT_FAILURE, errno, "replay_run: fclose");
+	return 0;
+}
@@ -0,0 +1,171 @@
+/*
+ * The dhcpd-pools has BSD 2-clause license which also known as "Simplified
+ * BSD License" or "FreeBSD License".
+ *
+ * Copyright 2006- Sami Kerola. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the
+ *       distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR AND CONTRIBUTORS OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing
+ * official policies, either expressed or implied, of Sami Kerola.
+ */
+
+
+/*! \file shm-reader.c
+ * \brief Reader library of the dhcpd-pools --shm segment.
+ *
+ * This file is built as libdhcpd-pools-shm, and depends only on the
+ * system C library so that other programs can link with it, and does
+ * not use config.h or gnulib.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "dhcpd-pools-shm.h"
+
+/*! \def SHM_READ_TRIES
+ * \brief How many times a busy segment is retried before giving up. */
+#define SHM_READ_TRIES 1000
+
+/*! \struct dhcpd_pools_shm
+ * \brief Reader handle. */
+struct dhcpd_pools_shm {
+	int fd;				/*!< Segment file descriptor. */
+	void *map;			/*!< Read-only mapping of the segment. */
+	size_t map_size;		/*!< Bytes mapped. */
+	char *copy;			/*!< Private copy the snapshot points to. */
+	size_t copy_size;		/*!< Allocated size of the copy. */
+};
+
+/*! \brief Map the segment again when the writer has grown it. */
+static int shm_remap(struct dhcpd_pools_shm *shm)
+{
+	struct stat st;
+	void *map;
+
+	if (fstat(shm->fd, &st))
+		return -1;
+	if ((size_t)st.st_size < sizeof(struct dhcpd_pools_shm_header)) {
+		errno = EAGAIN;
+		return -1;
+	}
+	if ((size_t)st.st_size == shm->map_size)
+		return 0;
+	map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, shm->fd, 0);
+	if (map == MAP_FAILED)
+		return -1;
+	if (shm->map)
+		munmap(shm->map, shm->map_size);
+	shm->map = map;
+	shm->map_size = st.st_size;
+	return 0;
+}
+
+struct dhcpd_pools_shm *dhcpd_pools_shm_open(const char *name)
+{
+	struct dhcpd_pools_shm *shm;
+
+	if ((shm = calloc(1, sizeof(*shm))) == NULL)
+		return NULL;
+	if ((shm->fd = shm_open(name, O_RDONLY, 0)) < 0) {
+		free(shm);
+		return NULL;
+	}
+	return shm;
+}
+
+int dhcpd_pools_shm_read(struct dhcpd_pools_shm *shm, struct dhcpd_pools_shm_snapshot *snap)
+{
+	const struct dhcpd_pools_shm_header *h;
+	struct dhcpd_pools_shm_header *copy;
+	uint64_t seq, size;
+	int tries;
+
+	for (tries = 0; tries < SHM_READ_TRIES; tries++) {
+		if (shm_remap(shm))
+			return -1;
+		h = shm->map;
+		seq = __atomic_load_n(&h->seq, __ATOMIC_ACQUIRE);
+		size = h->segment_size;
+		if (seq & 1 || seq == 0 || shm->map_size < size
+		    || size < sizeof(struct dhcpd_pools_shm_header)) {
+			/* update in progress, or segment is growing */
+			sched_yield();
+			continue;
+		}
+		if (shm->copy_size < size) {
+			free(shm->copy);
+			if ((shm->copy = malloc(size)) == NULL) {
+				shm->copy_size = 0;
+				return -1;
+			}
+			shm->copy_size = size;
+		}
+		memcpy(shm->copy, shm->map, size);
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+		if (__atomic_load_n(&h->seq, __ATOMIC_RELAXED) != seq)
+			continue;
+		copy = (struct dhcpd_pools_shm_header *)shm->copy;
+		if (copy->magic != DHCPD_POOLS_SHM_MAGIC || copy->version != DHCPD_POOLS_SHM_VERSION
+		    || copy->shnet_size < sizeof(struct dhcpd_pools_shm_shnet)
+		    || copy->range_size < sizeof(struct dhcpd_pools_shm_range)
+		    || size < copy->shnet_offset + (uint64_t)copy->num_shnets * copy->shnet_size
+		    || size < copy->range_offset + (uint64_t)copy->num_ranges * copy->range_size) {
+			errno = EPROTO;
+			return -1;
+		}
+		snap->generation = seq / 2;
+		snap->updated = copy->updated;
+		snap->ip_version = copy->ip_version;
+		snap->num_shnets = copy->num_shnets;
+		snap->num_ranges = copy->num_ranges;
+		snap->shnet_size = copy->shnet_size;
+		snap->range_size = copy->range_size;
+		snap->shnets = (const struct dhcpd_pools_shm_shnet *)(shm->copy + copy->shnet_offset);
+		snap->ranges = (const struct dhcpd_pools_shm_range *)(shm->copy + copy->range_offset);
+		return 0;
+	}
+	errno = EAGAIN;
+	return -1;
+}
+
+void dhcpd_pools_shm_close(struct dhcpd_pools_shm *shm)
+{
+	if (!shm)
+		return;
+	if (shm->map)
+		munmap(shm->map, shm->map_size);
+	close(shm->fd);
+	free(shm->copy);
+	free(shm);
+}
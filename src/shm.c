@@ -0,0 +1,210 @@
+/*
+ * The dhcpd-pools has BSD 2-clause license which also known as "Simplified
+ * BSD License" or "FreeBSD License".
+ *
+ * Copyright 2006- Sami Kerola. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the
+ *       distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR AND CONTRIBUTORS OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing
+ * official policies, either expressed or implied, of Sami Kerola.
+ */
+
+
+/*! \file shm.c
+ * \brief Publication of counters to a POSIX shared memory segment.
+ *
+ * The segment layout is in dhcpd-pools-shm.h, and local consumers read
+ * it with the reader library in shm-reader.c.  The segment is left in
+ * place when dhcpd-pools exits, so that a one-shot run from cron and a
+ * long running --listen or --snmp-pass-persist process can both keep it
+ * up to date.  Concurrent writers are serialized with flock().
+ */
+
+#include <config.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "error.h"
+
+#include "dhcpd-pools.h"
+#include "dhcpd-pools-shm.h"
+
+/*! \brief Open and map the segment, and initialize header when the
+ * segment is new or has an other layout version. */
+static void shm_attach(struct conf_t *state)
+{
+	struct stat st;
+	size_t size;
+
+	state->shm_fd = shm_open(state->shm_name, O_RDWR | O_CREAT, 0644);
+	if (state->shm_fd < 0)
+		error(EXIT_FAILURE, errno, "shm_attach: %s", state->shm_name);
+	if (flock(state->shm_fd, LOCK_EX))
+		error(EXIT_FAILURE, errno, "shm_attach: flock");
+	if (fstat(state->shm_fd, &st))
+		error(EXIT_FAILURE, errno, "shm_attach: fstat");
+	size = st.st_size;
+	if (size < sizeof(struct dhcpd_pools_shm_header)) {
+		size = sizeof(struct dhcpd_pools_shm_header);
+		if (ftruncate(state->shm_fd, size))
+			error(EXIT_FAILURE, errno, "shm_attach: ftruncate");
+	}
+	state->shm_map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, state->shm_fd, 0);
+	if (state->shm_map == MAP_FAILED)
+		error(EXIT_FAILURE, errno, "shm_attach: mmap");
+	state->shm_size = size;
+	if (state->shm_map->magic != DHCPD_POOLS_SHM_MAGIC
+	    || state->shm_map->version != DHCPD_POOLS_SHM_VERSION) {
+		/* keep sequence going, readers may have seen earlier layout */
+		state->shm_map->magic = DHCPD_POOLS_SHM_MAGIC;
+		state->shm_map->version = DHCPD_POOLS_SHM_VERSION;
+		state->shm_map->shnet_size = sizeof(struct dhcpd_pools_shm_shnet);
+		state->shm_map->range_size = sizeof(struct dhcpd_pools_shm_range);
+		state->shm_map->shnet_offset = sizeof(struct dhcpd_pools_shm_header);
+	}
+	flock(state->shm_fd, LOCK_UN);
+}
+
+/*! \brief Grow the segment when the tables do not fit.  Segment is never
+ * shrunk, readers may have it mapped.  An other writer may have grown it
+ * already, so the current size is checked with the lock held. */
+static void shm_reserve(struct conf_t *state, size_t size)
+{
+	struct stat st;
+	void *map;
+
+	if (size <= state->shm_size)
+		return;
+	if (fstat(state->shm_fd, &st))
+		error(EXIT_FAILURE, errno, "shm_reserve: fstat");
+	if (size < (size_t)st.st_size)
+		size = st.st_size;
+	else if (size != (size_t)st.st_size && ftruncate(state->shm_fd, size))
+		error(EXIT_FAILURE, errno, "shm_reserve: ftruncate");
+	map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, state->shm_fd, 0);
+	if (map == MAP_FAILED)
+		error(EXIT_FAILURE, errno, "shm_reserve: mmap");
+	munmap(state->shm_map, state->shm_size);
+	state->shm_map = map;
+	state->shm_size = size;
+}
+
+/*! \brief Copy a string to a fixed size record field. */
+static void shm_strcpy(char *dst, const char *src, size_t len)
+{
+	size_t n = strlen(src);
+
+	if (len <= n)
+		n = len - 1;
+	memcpy(dst, src, n);
+	memset(dst + n, 0, len - n);
+}
+
+/*! \brief Write shared network and range counters to the segment. */
+void shm_publish(struct conf_t *state)
+{
+	struct dhcpd_pools_shm_header *h;
+	struct dhcpd_pools_shm_shnet *s;
+	struct dhcpd_pools_shm_range *r;
+	struct shared_network_t *shared_p, *prev = NULL;
+	uint32_t num_shnets = 0, i, n, prev_n = 0;
+	uint64_t seq;
+	size_t size;
+
+	if (state->shm_map == NULL)
+		shm_attach(state);
+	for (shared_p = state->shared_net_root; shared_p; shared_p = shared_p->next)
+		num_shnets++;
+	if (flock(state->shm_fd, LOCK_EX))
+		error(EXIT_FAILURE, errno, "shm_publish: flock");
+	size = sizeof(struct dhcpd_pools_shm_header) +
+	    num_shnets * sizeof(struct dhcpd_pools_shm_shnet) +
+	    state->num_ranges * sizeof(struct dhcpd_pools_shm_range);
+	/* readers may remap now, but wait until seq is even again */
+	seq = state->shm_map->seq;
+	__atomic_store_n(&state->shm_map->seq, seq | 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	shm_reserve(state, size);
+	h = state->shm_map;
+
+	h->segment_size = size;
+	h->updated = time(NULL);
+	h->ip_version = state->ip_version == IPv6 ? 6 : 4;
+	h->num_shnets = num_shnets;
+	h->num_ranges = state->num_ranges;
+	h->shnet_offset = sizeof(struct dhcpd_pools_shm_header);
+	h->range_offset = h->shnet_offset + num_shnets * sizeof(struct dhcpd_pools_shm_shnet);
+	s = (struct dhcpd_pools_shm_shnet *)((char *)h + h->shnet_offset);
+	for (shared_p = state->shared_net_root; shared_p; shared_p = shared_p->next, s++) {
+		shm_strcpy(s->name, shared_p->name, sizeof(s->name));
+		s->available = shared_p->available;
+		s->used = shared_p->used;
+		s->touched = shared_p->touched;
+		s->backups = shared_p->backups;
+	}
+	r = (struct dhcpd_pools_shm_range *)((char *)h + h->range_offset);
+	for (i = 0; i < state->num_ranges; i++, r++) {
+		/* ranges of a shared network are usually next to each other */
+		if (state->ranges[i].shared_net != prev) {
+			prev = state->ranges[i].shared_net;
+			for (shared_p = state->shared_net_root, n = 0; shared_p;
+			     shared_p = shared_p->next, n++)
+				if (shared_p == prev)
+					break;
+			prev_n = shared_p ? n : 0;
+		}
+		shm_strcpy(r->first_ip, ntop_ipaddr(&state->ranges[i].first_ip), sizeof(r->first_ip));
+		shm_strcpy(r->last_ip, ntop_ipaddr(&state->ranges[i].last_ip), sizeof(r->last_ip));
+		r->shnet = prev_n;
+		r->reserved = 0;
+		r->available = get_range_size(&state->ranges[i]);
+		r->used = state->ranges[i].count;
+		r->touched = state->ranges[i].touched;
+		r->backups = state->ranges[i].backups;
+	}
+
+	__atomic_store_n(&h->seq, (seq | 1) + 1, __ATOMIC_RELEASE);
+	flock(state->shm_fd, LOCK_UN);
+}
+
+/*! \brief Unmap the segment.  The segment stays for readers. */
+void shm_detach(struct conf_t *state)
+{
+	if (state->shm_map == NULL)
+		return;
+	munmap(state->shm_map, state->shm_size);
+	close(state->shm_fd);
+	state->shm_map = NULL;
+}
@@ -0,0 +1,310 @@
+/*
+ * The dhcpd-pools has BSD 2-clause license which also known as "Simplified
+ * BSD License" or "FreeBSD License".
+ *
+ * Copyright 2006- Sami Kerola. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the
+ *       distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR AND CONTRIBUTORS OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing
+ * official policies, either expressed or implied, of Sami Kerola.
+ */
+
+
+/*! \file snmp.c
+ * \brief Net-SNMP pass_persist responder.
+ *
+ * The snmpd starts the responder once, and asks values of OIDs below the
+ * root OID with get and getnext commands in standard input.  Counted
+ * ranges and shared networks are kept in memory, and dhcpd files are
+ * analyzed again only when they change.  The OID layout is the same as
+ * in contrib/snmptest.pl, where X is an index starting from one.
+ *
+ *   root.1.X     shared network name
+ *   root.2.X     range name, that is the first IP of the range
+ *   root.3.X     index of the shared network of the range, 0 is none
+ *   root.4.1.X   shared network max, 4.2.X cur, 4.3.X touched
+ *   root.5.1.X   range max, 5.2.X cur, 5.3.X touched
+ *
+ * The OID table is generated in sorted order, so that both get and
+ * getnext are binary searches.
+ */
+
+#include <config.h>
+
+#include <errno.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "error.h"
+#include "xalloc.h"
+
+#include "dhcpd-pools.h"
+
+/*! \def SNMP_MAX_ARCS
+ * \brief Maximum number of arcs in an OID. */
+#define SNMP_MAX_ARCS 128
+
+/*! \def SNMP_LINE_LEN
+ * \brief Maximum length of a request line, enough for the longest OID. */
+#define SNMP_LINE_LEN (SNMP_MAX_ARCS * 11 + 2)
+
+/*! \struct snmp_oid
+ * \brief An OID below the root, and its value. */
+struct snmp_oid {
+	uint32_t arc[3];	/*!< Arcs after root OID. */
+	int num_arcs;		/*!< Number of arcs in use. */
+	const char *name;	/*!< String value, or NULL when value is integer. */
+	long value;		/*!< Integer value. */
+};
+
+/*! \struct snmp_table
+ * \brief Sorted OID table, and the data it was made of. */
+struct snmp_table {
+	uint32_t root[SNMP_MAX_ARCS];	/*!< Root OID arcs. */
+	int num_root;			/*!< Number of root arcs. */
+	struct file_stamp stamp;	/*!< State of dhcpd files at analysis. */
+	struct snmp_oid *oids;		/*!< Sorted OID array. */
+	size_t num_oids;		/*!< Number of entries in oids. */
+	char **range_names;		/*!< Range names the oids point to. */
+	unsigned int num_range_names;	/*!< Number of entries in range_names. */
+};
+
+/*! \brief Convert dotted OID to arcs.
+ * \return Number of arcs, or -1 when the OID is not valid. */
+static int snmp_parse_oid(const char *s, uint32_t *arc)
+{
+	int n = 0;
+	char *end;
+
+	if (*s == '.')
+		s++;
+	while (*s != '\0' && *s != '\n') {
+		if (SNMP_MAX_ARCS <= n || *s < '0' || '9' < *s)
+			return -1;
+		arc[n++] = strtoul(s, &end, 10);
+		s = end;
+		if (*s == '.')
+			s++;
+	}
+	return n;
+}
+
+/*! \brief Compare a request OID to a table entry.
+ * \return Less than, equal to, or greater than zero when request is less
+ * than, equal to, or greater than the entry. */
+static int snmp_oidcmp(const struct snmp_table *t, const uint32_t *req, int num_req,
+		       const struct snmp_oid *o)
+{
+	int i, len = t->num_root + o->num_arcs;
+	uint32_t a;
+
+	for (i = 0; i < num_req && i < len; i++) {
+		a = i < t->num_root ? t->root[i] : o->arc[i - t->num_root];
+		if (req[i] != a)
+			return req[i] < a ? -1 : 1;
+	}
+	return num_req - len;
+}
+
+/*! \brief Binary search the first entry that is not less than request.
+ * \param exact Set when the found entry is equal to the request. */
+static size_t snmp_search(const struct snmp_table *t, const uint32_t *req, int num_req,
+			  int *exact)
+{
+	size_t lo = 0, hi = t->num_oids, mid;
+	int cmp;
+
+	*exact = 0;
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		cmp = snmp_oidcmp(t, req, num_req, &t->oids[mid]);
+		if (cmp == 0) {
+			*exact = 1;
+			return mid;
+		}
+		if (cmp < 0)
+			hi = mid;
+		else
+			lo = mid + 1;
+	}
+	return lo;
+}
+
+/*! \brief Add an entry to the end of OID table. */
+static void snmp_add(struct snmp_table *t, size_t *size, uint32_t a0, uint32_t a1, uint32_t a2,
+		     const char *name, double value)
+{
+	struct snmp_oid *o;
+
+	if (*size <= t->num_oids) {
+		*size *= 2;
+		t->oids = xrealloc(t->oids, sizeof(struct snmp_oid) * *size);
+	}
+	o = &t->oids[t->num_oids++];
+	o->arc[0] = a0;
+	o->arc[1] = a1;
+	o->arc[2] = a2;
+	o->num_arcs = a2 ? 3 : 2;
+	o->name = name;
+	/* snmptest.pl compatible integer type is signed 32 bit */
+	o->value = INT32_MAX < value ? INT32_MAX : (long)value;
+}
+
+/*! \brief Free OID table content, but keep root OID. */
+static void snmp_free_table(struct snmp_table *t)
+{
+	unsigned int i;
+
+	for (i = 0; i < t->num_range_names; i++)
+		free(t->range_names[i]);
+	free(t->range_names);
+	free(t->oids);
+	t->range_names = NULL;
+	t->num_range_names = 0;
+	t->oids = NULL;
+	t->num_oids = 0;
+}
+
+/*! \brief Make OID table of the analysis in sorted order. */
+static void snmp_build_table(struct conf_t *state, struct snmp_table *t)
+{
+	struct shared_network_t *shared_p;
+	struct range_t *range_p;
+	size_t size = 64;
+	unsigned int i, j, n;
+
+	snmp_free_table(t);
+	t->oids = xmalloc(sizeof(struct snmp_oid) * size);
+	t->range_names = xmalloc(sizeof(char *) * (state->num_ranges + 1));
+	for (i = 0; i < state->num_ranges; i++)
+		t->range_names[i] = xstrdup(ntop_ipaddr(&state->ranges[i].first_ip));
+	t->num_range_names = state->num_ranges;
+	/* shared network index of ranges, root is 0 */
+	number_shnets(state);
+
+	for (shared_p = state->shared_net_root->next, n = 1; shared_p; shared_p = shared_p->next, n++)
+		snmp_add(t, &size, 1, n, 0, shared_p->name, 0);
+	for (i = 0; i < state->num_ranges; i++)
+		snmp_add(t, &size, 2, i + 1, 0, t->range_names[i], 0);
+	for (i = 0; i < state->num_ranges; i++)
+		snmp_add(t, &size, 3, i + 1, 0, NULL, state->ranges[i].shared_net->number);
+	for (j = 1; j <= 3; j++)
+		for (shared_p = state->shared_net_root->next, n = 1; shared_p;
+		     shared_p = shared_p->next, n++)
+			snmp_add(t, &size, 4, j, n, NULL,
+				 j == 1 ? shared_p->available : j == 2 ? shared_p->used : shared_p->touched);
+	for (j = 1; j <= 3; j++)
+		for (i = 0, range_p = state->ranges; i < state->num_ranges; i++, range_p++)
+			snmp_add(t, &size, 5, j, i + 1, NULL,
+				 j == 1 ? get_range_size(range_p) : j == 2 ? range_p->count
+				 : range_p->touched);
+}
+
+/*! \brief Answer a get or getnext request. */
+static void snmp_answer(struct conf_t *state, struct snmp_table *t, const char *oid, int next)
+{
+	uint32_t req[SNMP_MAX_ARCS];
+	int num_req, exact, i;
+	size_t pos;
+	struct snmp_oid *o;
+
+	if (refresh_analysis(state, &t->stamp, 0))
+		snmp_build_table(state, t);
+	if ((num_req = snmp_parse_oid(oid, req)) < 0) {
+		printf("NONE\n");
+		return;
+	}
+	pos = snmp_search(t, req, num_req, &exact);
+	if (next && exact)
+		pos++;
+	if ((!next && !exact) || t->num_oids <= pos) {
+		printf("NONE\n");
+		return;
+	}
+	o = &t->oids[pos];
+	for (i = 0; i < t->num_root; i++)
+		printf(".%u", t->root[i]);
+	for (i = 0; i < o->num_arcs; i++)
+		printf(".%u", o->arc[i]);
+	if (o->name)
+		printf("\nstring\n%s\n", o->name);
+	else
+		printf("\ninteger\n%ld\n", o->value);
+}
+
+/*! \brief Read a line without trailing new line.
+ * \return Zero at end of input. */
+static int snmp_getline(char *line)
+{
+	char *nl;
+
+	if (!fgets(line, SNMP_LINE_LEN, stdin))
+		return 0;
+	if ((nl = strchr(line, '\n')) != NULL)
+		*nl = '\0';
+	return 1;
+}
+
+/*! \brief Run pass_persist protocol in standard input and output until
+ * snmpd closes the input.
+ * \return Program exit value. */
+int snmp_pass_persist(struct conf_t *state)
+{
+	struct snmp_table t = { .num_root = 0 };
+	char *line, *arg;
+
+	t.num_root = snmp_parse_oid(state->snmp_root, t.root);
+	if (t.num_root < 1 || SNMP_MAX_ARCS - 3 < t.num_root)
+		error(EXIT_FAILURE, 0, "snmp_pass_persist: invalid root oid: %s", state->snmp_root);
+	line = xmalloc(SNMP_LINE_LEN);
+	arg = xmalloc(SNMP_LINE_LEN);
+	while (snmp_getline(line) && line[0] != '\0') {
+		if (!strcmp(line, "PING")) {
+			printf("PONG\n");
+		} else if (!strcmp(line, "get") || !strcmp(line, "getnext")) {
+			if (!snmp_getline(arg))
+				break;
+			snmp_answer(state, &t, arg, line[3] == 'n');
+		} else if (!strcmp(line, "set")) {
+			/* oid and value lines */
+			if (!snmp_getline(arg) || !snmp_getline(arg))
+				break;
+			printf("not-writable\n");
+		} else {
+			printf("NONE\n");
+		}
+		if (fflush(stdout))
+			error(EXIT_FAILURE, errno, "snmp_pass_persist: fflush");
+	}
+	snmp_free_table(&t);
+	free(line);
+	free(arg);
+	return 0;
+}
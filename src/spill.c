@@ -0,0 +1,325 @@
+/*
+ * The dhcpd-pools has BSD 2-clause license which also known as "Simplified
+ * BSD License" or "FreeBSD License".
+ *
+ * Copyright 2006- Sami Kerola. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the
+ *       distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR AND CONTRIBUTORS OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing
+ * official policies, either expressed or implied, of Sami Kerola.
+ */
+
+
+/*! \file spill.c
+ * \brief Memory bounded lease table for very large lease files.
+ *
+ * When the lease hash would grow past --memory-limit the leases are moved
+ * to a buffer of small fixed size records, and the following binding
+ * states are appended to the buffer instead of the hash.  A full buffer is
+ * sorted by address and record sequence, and written to a temporary file
+ * as a run.  Counting merges the runs with a heap, keeps the last record
+ * of each address, and adds it to range counters, so the lease table is
+ * never in memory as a whole.  An address is credited to one range only,
+ * the first one that has it, even when ranges overlap.  The number of open
+ * runs is bounded by merging them to a single run whenever SPILL_FAN_IN
+ * runs exist.  Hardware addresses and lease times are not kept in this
+ * mode.
+ */
+
+#include <config.h>
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "error.h"
+#include "xalloc.h"
+
+#include "dhcpd-pools.h"
+
+/*! \def LEASE_COST
+ * \brief Estimated memory use of a lease in the hash, including the hash
+ * handle and allocator overhead.
+ */
+#define LEASE_COST (sizeof(struct leases_t) + 32)
+
+/*! \def SPILL_FAN_IN
+ * \brief Number of runs that are merged at once, and so the maximum
+ * number of temporary files open at the same time.
+ */
+#define SPILL_FAN_IN 64
+
+/*! \struct spill_rec
+ * \brief A binding state of an address.
+ */
+struct spill_rec {
+	union ipaddr_t ip;
+	uint64_t seq;			/*!< Order of the record in the lease file. */
+	uint32_t type;			/*!< The ltype of the record. */
+};
+
+/*! \struct spill_t
+ * \brief Record buffer and runs written so far.
+ */
+struct spill_t {
+	struct spill_rec *buf;
+	size_t len;			/*!< Records in buffer. */
+	size_t size;			/*!< Buffer capacity. */
+	uint64_t seq;			/*!< Sequence of the next record. */
+	FILE **runs;			/*!< Sorted temporary files. */
+	unsigned int num_runs;
+};
+
+/*! \struct spill_head
+ * \brief Merge heap entry, the next record of a run.
+ */
+struct spill_head {
+	struct spill_rec rec;
+	FILE *run;
+};
+
+/*! \brief Compare records by address and sequence. */
+static int spill_comp(const void *a, const void *b)
+{
+	const struct spill_rec *x = a, *y = b;
+	int ret = ipcomp(&x->ip, &y->ip);
+
+	if (ret)
+		return ret;
+	return (x->seq > y->seq) - (x->seq < y->seq);
+}
+
+/*! \brief Create an anonymous temporary file in TMPDIR.
+ * \return Stream open for reading and writing. */
+static FILE *spill_tmpfile(void)
+{
+	const char *dir = getenv("TMPDIR");
+	char *path;
+	FILE *f;
+	int fd;
+
+	if (dir == NULL || *dir == '\0')
+		dir = "/tmp";
+	path = xmalloc(strlen(dir) + sizeof("/dhcpd-pools.XXXXXX"));
+	sprintf(path, "%s/dhcpd-pools.XXXXXX", dir);
+	fd = mkstemp(path);
+	if (fd < 0 && (errno == EMFILE || errno == ENFILE))
+		error(EXIT_FAILURE, errno, "spill_tmpfile: %s: raise --memory-limit", path);
+	if (fd < 0)
+		error(EXIT_FAILURE, errno, "spill_tmpfile: %s", path);
+	/* removed at close */
+	unlink(path);
+	free(path);
+	f = fdopen(fd, "w+");
+	if (f == NULL)
+		error(EXIT_FAILURE, errno, "spill_tmpfile: fdopen");
+	return f;
+}
+
+/*! \brief Restore heap order from an entry downwards. */
+static void spill_sift(struct spill_head *heap, unsigned int n, unsigned int i)
+{
+	struct spill_head tmp;
+	unsigned int c;
+
+	while ((c = 2 * i + 1) < n) {
+		if (c + 1 < n && spill_comp(&heap[c + 1].rec, &heap[c].rec) < 0)
+			c++;
+		if (spill_comp(&heap[i].rec, &heap[c].rec) <= 0)
+			break;
+		tmp = heap[i];
+		heap[i] = heap[c];
+		heap[c] = tmp;
+		i = c;
+	}
+}
+
+/*! \brief Merge runs with a heap, and pass the last record of every
+ * address to a function.  The runs are closed. */
+static void spill_merge(FILE **runs, unsigned int num_runs,
+			void (*emit)(void *arg, const struct spill_rec *r), void *arg)
+{
+	struct spill_head *heap;
+	struct spill_rec last;
+	unsigned int i, n = 0;
+	int have_last = 0;
+
+	heap = xmalloc(sizeof(struct spill_head) * (num_runs ? num_runs : 1));
+	for (i = 0; i < num_runs; i++) {
+		heap[n].run = runs[i];
+		if (fread(&heap[n].rec, sizeof(struct spill_rec), 1, runs[i]) == 1)
+			n++;
+	}
+	for (i = n / 2; 0 < i--;)
+		spill_sift(heap, n, i);
+	while (n) {
+		if (have_last && ipcomp(&last.ip, &heap[0].rec.ip))
+			emit(arg, &last);
+		/* same address in a later record wins */
+		last = heap[0].rec;
+		have_last = 1;
+		if (fread(&heap[0].rec, sizeof(struct spill_rec), 1, heap[0].run) != 1) {
+			if (ferror(heap[0].run))
+				error(EXIT_FAILURE, errno, "spill_merge: read");
+			heap[0] = heap[--n];
+		}
+		spill_sift(heap, n, 0);
+	}
+	if (have_last)
+		emit(arg, &last);
+	free(heap);
+	for (i = 0; i < num_runs; i++)
+		fclose(runs[i]);
+}
+
+/*! \brief Write a merged record to a run. */
+static void spill_write(void *arg, const struct spill_rec *r)
+{
+	if (fwrite(r, sizeof(struct spill_rec), 1, arg) != 1)
+		error(EXIT_FAILURE, errno, "spill_write: write");
+}
+
+/*! \brief Sort the buffer and write it to a new run. */
+static void spill_flush(struct spill_t *s)
+{
+	FILE *run;
+
+	if (s->len == 0)
+		return;
+	qsort(s->buf, s->len, sizeof(struct spill_rec), spill_comp);
+	run = spill_tmpfile();
+	if (fwrite(s->buf, sizeof(struct spill_rec), s->len, run) != s->len || fflush(run))
+		error(EXIT_FAILURE, errno, "spill_flush: write");
+	rewind(run);
+	s->runs = xrealloc(s->runs, sizeof(FILE *) * (s->num_runs + 1));
+	s->runs[s->num_runs++] = run;
+	s->len = 0;
+	if (s->num_runs < SPILL_FAN_IN)
+		return;
+	/* the merged run keeps the last record of each address, which is
+	 * enough because later runs have later records */
+	run = spill_tmpfile();
+	spill_merge(s->runs, s->num_runs, spill_write, run);
+	if (fflush(run))
+		error(EXIT_FAILURE, errno, "spill_flush: write");
+	rewind(run);
+	s->runs[0] = run;
+	s->num_runs = 1;
+}
+
+/*! \brief Add a binding state of an address to the buffer. */
+void spill_lease(struct conf_t *state, const union ipaddr_t *addr, enum ltype type)
+{
+	struct spill_t *s = state->spill;
+	struct spill_rec *r;
+
+	if (s->len == s->size)
+		spill_flush(s);
+	r = s->buf + s->len++;
+	memset(r, 0, sizeof(*r));
+	copy_ipaddr(&r->ip, addr);
+	r->seq = s->seq++;
+	r->type = type;
+}
+
+/*! \brief Switch to spilling when the lease hash is over memory limit.
+ * Leases of the hash are moved to the buffer as the first records.
+ * \return Non-zero when the hash was emptied. */
+int spill_check(struct conf_t *state)
+{
+	struct spill_t *s;
+	struct leases_t *l;
+
+	if (HASH_COUNT(state->leases) * LEASE_COST <= state->memory_limit)
+		return 0;
+	s = xcalloc(1, sizeof(struct spill_t));
+	s->size = state->memory_limit / sizeof(struct spill_rec);
+	if (s->size == 0)
+		s->size = 1;
+	s->buf = xmalloc(sizeof(struct spill_rec) * s->size);
+	state->spill = s;
+	for (l = state->leases; l; l = l->hh.next)
+		spill_lease(state, &l->ip, l->type);
+	delete_all_leases(state);
+	return 1;
+}
+
+/*! \brief Add final state of an address to the range it belongs to. */
+static void spill_count_one(void *arg, const struct spill_rec *r)
+{
+	struct conf_t *state = arg;
+	struct range_t *range_p = find_range(state, &r->ip);
+
+	if (range_p == NULL)
+		return;
+	switch (r->type) {
+	case FREE:
+		range_p->touched++;
+		break;
+	case ACTIVE:
+		range_p->count++;
+		break;
+	case BACKUP:
+		range_p->backups++;
+		break;
+	}
+	if (range_p->bitmap)
+		bitmap_mark(range_p, &r->ip, r->type);
+}
+
+/*! \brief Merge the runs, and count the last record of every address to
+ * range counters.  Ranges must be sorted.  The spill state is freed. */
+void spill_count(struct conf_t *state)
+{
+	struct spill_t *s = state->spill;
+
+	spill_flush(s);
+	free(s->buf);
+	s->buf = NULL;
+	spill_merge(s->runs, s->num_runs, spill_count_one, state);
+	s->num_runs = 0;
+	spill_free(state);
+}
+
+/*! \brief Free spill buffer and remove the runs. */
+void spill_free(struct conf_t *state)
+{
+	struct spill_t *s = state->spill;
+	unsigned int i;
+
+	if (s == NULL)
+		return;
+	for (i = 0; i < s->num_runs; i++)
+		fclose(s->runs[i]);
+	free(s->runs);
+	free(s->buf);
+	free(s);
+	state->spill = NULL;
+}
@@ -0,0 +1,253 @@
+/*
+ * The dhcpd-pools has BSD 2-clause license which also known as "Simplified
+ * BSD License" or "FreeBSD License".
+ *
+ * Copyright 2006- Sami Kerola. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the
+ *       distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR AND CONTRIBUTORS OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing
+ * official policies, either expressed or implied, of Sami Kerola.
+ */
+
+
+/*! \file microbench.c
+ * \brief Microbenchmarks of address and lease line primitives.
+ *
+ * Every primitive is ran over a corpus that looks like real dhcpd data,
+ * and the average time per call is printed.  The corpora are generated
+ * with a fixed seed, so that runs are comparable.  Results of conversion
+ * round trips are verified, and a mismatch makes exit value non-zero.
+ *
+ * Usage: tests/microbench [passes]
+ */
+
+#include <config.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "progname.h"
+#include "xalloc.h"
+
+#include "dhcpd-pools.h"
+
+/* Function pointers main() of dhcpd-pools.c would define. */
+THREAD_LOCAL int (*parse_ipaddr) (struct conf_t *state, const char *restrict src, union ipaddr_t *restrict dst);
+THREAD_LOCAL void (*copy_ipaddr) (union ipaddr_t *restrict dst, const union ipaddr_t *restrict src);
+THREAD_LOCAL const char *(*ntop_ipaddr) (const union ipaddr_t *ip);
+THREAD_LOCAL double (*get_range_size) (const struct range_t *r);
+THREAD_LOCAL int (*xstrstr) (struct conf_t *state, const char *restrict str);
+THREAD_LOCAL int (*ipcomp) (const union ipaddr_t *restrict a, const union ipaddr_t *restrict b);
+THREAD_LOCAL int (*leasecomp) (const struct leases_t *restrict a, const struct leases_t *restrict b);
+THREAD_LOCAL struct leases_t *(*add_lease) (struct conf_t *state, union ipaddr_t *ip, enum ltype type);
+THREAD_LOCAL struct leases_t *(*find_lease) (struct conf_t *state, union ipaddr_t *ip);
+
+/*! \def CORPUS_SIZE
+ * \brief Number of addresses and lease file lines in each corpus. */
+#define CORPUS_SIZE 4096
+
+/*! \var sink
+ * \brief Results are added here so that compiler cannot drop the calls. */
+static volatile unsigned long sink;
+
+/*! \brief Lease file lines of one address, the %s is replaced with address. */
+static const char *v4_lease[] = {
+	"lease %s {\n",
+	"  starts 4 2026/10/01 10:00:00;\n",
+	"  ends 4 2026/10/01 22:00:00;\n",
+	"  tstp 4 2026/10/01 22:00:00;\n",
+	"  cltt 4 2026/10/01 10:00:00;\n",
+	"  binding state active;\n",
+	"  next binding state free;\n",
+	"  rewind binding state free;\n",
+	"  hardware ethernet 00:16:3e:4a:2b:1c;\n",
+	"  uid \"\\001\\000\\026>J+\\034\";\n",
+	"  client-hostname \"workstation\";\n",
+	"}\n"
+};
+
+static const char *v6_lease[] = {
+	"ia-na \"\\001\\000\\000\\000\\000\\001\\000\\001\" {\n",
+	"  cltt 4 2026/10/01 10:00:00;\n",
+	"  iaaddr %s {\n",
+	"    binding state active;\n",
+	"    preferred-life 3600;\n",
+	"    max-life 7200;\n",
+	"    ends 4 2026/10/01 12:00:00;\n",
+	"  }\n",
+	"}\n"
+};
+
+/*! \brief Benchmark corpus of one address family. */
+struct corpus {
+	char *addr[CORPUS_SIZE];		/*!< Addresses as text. */
+	union ipaddr_t ip[CORPUS_SIZE];		/*!< Addresses in binary. */
+	char *line[CORPUS_SIZE];		/*!< Lease file lines. */
+};
+
+/*! \brief Nanoseconds since an arbitrary point. */
+static double now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/*! \brief Print time per operation. */
+static void report(const char *name, double start, unsigned long ops)
+{
+	printf("%-22s %10.2f ns/op\n", name, (now_ns() - start) / ops);
+}
+
+/*! \brief Make addresses and lease lines of a corpus. */
+static void make_corpus(struct conf_t *state, struct corpus *c, const int version)
+{
+	const char **lease = version == IPv4 ? v4_lease : v6_lease;
+	size_t nlines = version == IPv4 ? sizeof(v4_lease) / sizeof(v4_lease[0])
+	    : sizeof(v6_lease) / sizeof(v6_lease[0]);
+	char buf[128];
+	int i, r;
+
+	for (i = 0; i < CORPUS_SIZE; i++) {
+		r = rand();
+		if (version == IPv4)
+			snprintf(buf, sizeof(buf), "10.%d.%d.%d", r & 0xff, (r >> 8) & 0xff,
+				 (r >> 16) & 0xff);
+		else
+			snprintf(buf, sizeof(buf), "2001:db8:%x:%x::%x:%x", r & 0xff,
+				 (r >> 8) & 0xffff, (r >> 4) & 0xfff, rand() & 0xffff);
+		c->addr[i] = xstrdup(buf);
+		parse_ipaddr(state, c->addr[i], &c->ip[i]);
+		snprintf(buf, sizeof(buf), lease[i % nlines], c->addr[i]);
+		c->line[i] = xstrdup(buf);
+	}
+}
+
+/*! \brief Free memory allocated by make_corpus(). */
+static void free_corpus(struct corpus *c)
+{
+	int i;
+
+	for (i = 0; i < CORPUS_SIZE; i++) {
+		free(c->addr[i]);
+		free(c->line[i]);
+	}
+}
+
+/*! \brief Run benchmarks of one address family.
+ * \return Number of round trip errors. */
+static int run(const int version, const unsigned long passes)
+{
+	struct conf_t state = { 0 };
+	struct corpus c;
+	struct range_t range;
+	union ipaddr_t ip;
+	unsigned long p, ops = passes * CORPUS_SIZE;
+	int i, errors = 0;
+	double start;
+	const int v4 = version == IPv4;
+
+	set_ipv_functions(&state, version);
+	make_corpus(&state, &c, version);
+
+	start = now_ns();
+	for (p = 0; p < passes; p++)
+		for (i = 0; i < CORPUS_SIZE; i++)
+			sink += xstrstr(&state, c.line[i]);
+	report(v4 ? "xstrstr_v4" : "xstrstr_v6", start, ops);
+
+	state.lease_times = 1;
+	start = now_ns();
+	for (p = 0; p < passes; p++)
+		for (i = 0; i < CORPUS_SIZE; i++)
+			sink += xstrstr(&state, c.line[i]);
+	report(v4 ? "xstrstr_v4 lease_times" : "xstrstr_v6 lease_times", start, ops);
+
+	start = now_ns();
+	for (p = 0; p < passes; p++)
+		for (i = 0; i < CORPUS_SIZE; i++)
+			sink += parse_ipaddr(&state, c.addr[i], &ip);
+	report(v4 ? "parse_ipaddr_v4" : "parse_ipaddr_v6", start, ops);
+
+	start = now_ns();
+	for (p = 0; p < passes; p++)
+		for (i = 1; i < CORPUS_SIZE; i++)
+			sink += ipcomp(&c.ip[i - 1], &c.ip[i]);
+	report(v4 ? "ipcomp_v4" : "ipcomp_v6", start, passes * (CORPUS_SIZE - 1));
+
+	start = now_ns();
+	for (p = 0; p < passes; p++)
+		for (i = 0; i < CORPUS_SIZE; i++)
+			sink += ntop_ipaddr(&c.ip[i])[0];
+	report(v4 ? "ntop_ipaddr_v4" : "ntop_ipaddr_v6", start, ops);
+
+	if (!v4) {
+		start = now_ns();
+		for (p = 0; p < passes; p++)
+			for (i = 1; i < CORPUS_SIZE; i++) {
+				if (ipcomp(&c.ip[i - 1], &c.ip[i]) < 0) {
+					copy_ipaddr(&range.first_ip, &c.ip[i - 1]);
+					copy_ipaddr(&range.last_ip, &c.ip[i]);
+				} else {
+					copy_ipaddr(&range.first_ip, &c.ip[i]);
+					copy_ipaddr(&range.last_ip, &c.ip[i - 1]);
+				}
+				sink += get_range_size(&range);
+			}
+		report("get_range_size_v6", start, passes * (CORPUS_SIZE - 1));
+	}
+
+	for (i = 0; i < CORPUS_SIZE; i++) {
+		if (!parse_ipaddr(&state, ntop_ipaddr(&c.ip[i]), &ip)
+		    || ipcomp(&ip, &c.ip[i]) != 0) {
+			fprintf(stderr, "round trip failed: %s\n", c.addr[i]);
+			errors++;
+		}
+	}
+	free_corpus(&c);
+	return errors;
+}
+
+/*! \brief Run benchmarks of both address families. */
+int main(int argc, char **argv)
+{
+	unsigned long passes = 1000;
+	int errors;
+
+	set_program_name(argv[0]);
+	if (1 < argc)
+		passes = strtoul(argv[1], NULL, 10);
+	if (passes == 0)
+		passes = 1;
+	srand(1);
+	errors = run(IPv4, passes);
+	errors += run(IPv6, passes);
+	return errors ? EXIT_FAILURE : EXIT_SUCCESS;
+}
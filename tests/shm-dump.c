@@ -0,0 +1,102 @@
+/*
+ * The dhcpd-pools has BSD 2-clause license which also known as "Simplified
+ * BSD License" or "FreeBSD License".
+ *
+ * Copyright 2006- Sami Kerola. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the
+ *       distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR AND CONTRIBUTORS OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are
+ * those of the authors and should not be interpreted as representing
+ * official policies, either expressed or implied, of Sami Kerola.
+ */
+
+
+/*! \file shm-dump.c
+ * \brief Print a snapshot of the dhcpd-pools --shm segment.
+ *
+ * This is an example consumer of the reader library, and the test suite
+ * uses it to verify the segment contents.  Counters are printed as tab
+ * separated text, one shared network or range in a line.
+ *
+ * Usage: tests/shm-dump [-u] NAME
+ *   -u  remove the segment after printing
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#include "dhcpd-pools-shm.h"
+
+int main(int argc, char **argv)
+{
+	struct dhcpd_pools_shm *shm;
+	struct dhcpd_pools_shm_snapshot snap;
+	const struct dhcpd_pools_shm_shnet *s;
+	const struct dhcpd_pools_shm_range *r;
+	const char *name;
+	int unlink_after = 0;
+	uint32_t i;
+
+	if (argc == 3 && !strcmp(argv[1], "-u"))
+		unlink_after = 1;
+	else if (argc != 2) {
+		fprintf(stderr, "usage: %s [-u] NAME\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+	name = argv[argc - 1];
+	if ((shm = dhcpd_pools_shm_open(name)) == NULL) {
+		fprintf(stderr, "%s: %s: %s\n", argv[0], name, strerror(errno));
+		return EXIT_FAILURE;
+	}
+	if (dhcpd_pools_shm_read(shm, &snap)) {
+		fprintf(stderr, "%s: %s: %s\n", argv[0], name, strerror(errno));
+		dhcpd_pools_shm_close(shm);
+		return EXIT_FAILURE;
+	}
+	printf("generation\t%llu\nip_version\t%u\n", (unsigned long long)snap.generation,
+	       snap.ip_version);
+	printf("shnets\t%u\n", snap.num_shnets);
+	for (i = 0; i < snap.num_shnets; i++) {
+		s = DHCPD_POOLS_SHM_SHNET(&snap, i);
+		printf("%u\t%s\t%g\t%g\t%g\t%g\n", i, s->name, s->available, s->used,
+		       s->touched, s->backups);
+	}
+	printf("ranges\t%u\n", snap.num_ranges);
+	for (i = 0; i < snap.num_ranges; i++) {
+		r = DHCPD_POOLS_SHM_RANGE(&snap, i);
+		printf("%s\t%s\t%u\t%g\t%g\t%g\t%g\n", r->first_ip, r->last_ip, r->shnet,
+		       r->available, r->used, r->touched, r->backups);
+	}
+	dhcpd_pools_shm_close(shm);
+	if (unlink_after && shm_unlink(name)) {
+		fprintf(stderr, "%s: %s: %s\n", argv[0], name, strerror(errno));
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}